@@ -0,0 +1,913 @@
+// Microbenchmarks for the lexer and the analysis passes.
+//
+// Build from the root of the project with one command (split over several
+// lines here):
+//
+//     g++ bench/bench.cpp src/lexer.cpp src/parser.cpp src/traversal.cpp
+//         src/flowgraph.cpp src/summary.cpp src/callgraph.cpp
+//         src/pathnumbering.cpp src/explore.cpp src/sampling.cpp
+//         src/dominators.cpp src/dataflow.cpp src/loops.cpp src/ir.cpp
+//         src/irwriter.cpp -std=c++20 -O2 -pthread -o bench_fa
+//
+// and run one benchmark per process:
+//
+//     ./bench_fa keywords [megabytes]
+//     ./bench_fa comments [megabytes]
+//     ./bench_fa literals [megabytes]
+//     ./bench_fa nesting [depth]
+//     ./bench_fa passes [definitions]
+//     ./bench_fa returns [calls]
+//     ./bench_fa explore [ifs]
+//     ./bench_fa samples [walks]
+//     ./bench_fa dominators [blocks]
+//     ./bench_fa dataflow [blocks]
+//     ./bench_fa loops [blocks]
+//     ./bench_fa complexity [size]
+//     ./bench_fa binary [definitions]
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "../include/dataflow.h"
+#include "../include/dominators.h"
+#include "../include/lexExtern.h"
+#include "../include/loops.h"
+#include "../include/parser.h"
+
+static std::string writeSource(const std::string& name,
+                               const std::string& text) {
+  auto path = std::filesystem::temp_directory_path() / name;
+  std::ofstream out(path, std::ios::binary);
+  out << text;
+  return path.string();
+}
+
+// Lexes the whole file and reports throughput.
+static void lexFile(const std::string& path) {
+  SymbolTable symbols;
+  LexerContext lexer(symbols);
+  if (!lexer.openSource(path)) {
+    std::cout << "Could not open file \"" << path << "\"" << std::endl;
+    std::exit(1);
+  }
+  std::size_t bytes = lexer.source.end - lexer.source.begin;
+
+  auto t0 = std::chrono::steady_clock::now();
+  std::size_t tokens = 0;
+  while (lexer.getToken() != tok_eof) {
+    tokens++;
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  double secs = std::chrono::duration<double>(t1 - t0).count();
+
+  std::printf("%zu bytes, %zu tokens in %.3f s: %.2f Mtok/s, %.1f MB/s\n",
+              bytes, tokens, secs, tokens / secs / 1e6, bytes / secs / 1e6);
+  lexer.closeSource();
+}
+
+// Keyword-heavy input: every statement mixes keywords of both spellings
+// with ordinary identifiers.
+static void benchKeywords(std::size_t megabytes) {
+  static const char* line =
+      "def f(a, b) if a then (for i = a when b inc a do (x)) else "
+      "(var v = a in (DEF IF THEN ELSE FOR WHEN INC DO VAR IN extern "
+      "binary unary define EXTERN foo bar baz));\n";
+  std::string text;
+  while (text.size() < megabytes << 20) text += line;
+  lexFile(writeSource("fa_bench_keywords.txt", text));
+}
+
+// Comment-heavy input: long comment lines full of code-like text between
+// short statements.
+static void benchComments(std::size_t megabytes) {
+  std::string comment = "# ";
+  while (comment.size() < 400) comment += "if x then (foo(1, 2.5)) else (y) ";
+  comment += "\n";
+  std::string text;
+  while (text.size() < megabytes << 20) {
+    text += comment;
+    text += comment;
+    text += "def f(a) a + 1;\n";
+  }
+  lexFile(writeSource("fa_bench_comments.txt", text));
+}
+
+// Literal-heavy input: integer and fractional constants of varying length.
+static void benchLiterals(std::size_t megabytes) {
+  std::string text;
+  unsigned long long x = 88172645463325252ULL;
+  while (text.size() < megabytes << 20) {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    text += std::to_string(x % 1000000);
+    text += (x & 1) ? "." + std::to_string(x % 9973) + " " : " ";
+  }
+  lexFile(writeSource("fa_bench_literals.txt", text));
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point t0) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0)
+      .count();
+}
+
+// One definition whose body nests `depth` levels of a construct.
+static std::string nestedSource(const std::string& kind, std::size_t depth) {
+  std::string text = "def main(x) ";
+  auto repeat = [&](const char* s, std::size_t n) {
+    while (n--) text += s;
+  };
+  if (kind == "parens") {
+    repeat("(", depth);
+    text += "x";
+    repeat(")", depth);
+  } else if (kind == "unary") {
+    repeat("-", depth);
+    text += "x";
+  } else if (kind == "sequence") {
+    text += "x";
+    repeat(" : x", depth);
+  } else if (kind == "if") {
+    repeat("if x then (", depth);
+    text += "x";
+    repeat(") else (x)", depth);
+  } else if (kind == "call") {
+    repeat("f(", depth);
+    text += "x";
+    repeat(")", depth);
+  }
+  text += ";\n";
+  return text;
+}
+
+static void setPrecedences(AnalysisSession& session) {
+  session.binOpPrecedence[':'] = 1;
+  session.binOpPrecedence['='] = 2;
+  session.binOpPrecedence['<'] = 10;
+  session.binOpPrecedence['+'] = 20;
+  session.binOpPrecedence['-'] = 20;
+  session.binOpPrecedence['*'] = 40;
+}
+
+// A file opened for writing (and truncated) for as long as the object
+// lives.
+struct OutputFile {
+  explicit OutputFile(const std::string& path)
+      : fd(open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)) {}
+  OutputFile(const OutputFile&) = delete;
+  OutputFile& operator=(const OutputFile&) = delete;
+  ~OutputFile() { close(fd); }
+
+  int fd;
+};
+
+// A session for one benchmark run, writing to `outPath` (/dev/null unless
+// given); the source it opens is closed, and the output after it, when the
+// session goes.
+struct BenchSession {
+  explicit BenchSession(const std::string& outPath = "/dev/null")
+      : output(outPath) {
+    setPrecedences(session);
+  }
+  ~BenchSession() { session.lexer.closeSource(); }
+
+  // Opens and lexes `path`; no benchmark can go on without it.
+  void open(const std::string& path) {
+    if (!session.open(path)) {
+      std::cout << "Could not open file \"" << path << "\"" << std::endl;
+      std::exit(1);
+    }
+  }
+
+  OutputFile output;
+  AnalysisSession session{output.fd};
+};
+
+// Parses and traverses every definition left in the session's tokens.
+static void traverseDefinitions(AnalysisSession& session) {
+  while (session.parser.curTok != tok_eof) {
+    if (session.parser.curTok == tok_def) {
+      session.genDefinition();
+    } else {
+      session.parser.getNextToken();
+    }
+  }
+}
+
+// A session over `path` with every definition parsed and traversed: the IR
+// is built but not printed.
+static std::unique_ptr<BenchSession> loadSession(const std::string& path) {
+  auto bench = std::make_unique<BenchSession>();
+  AnalysisSession& session = bench->session;
+  session.emitIR = false;
+  bench->open(path);
+  traverseDefinitions(session);
+  return bench;
+}
+
+// Parses every definition left in the parser's tokens, without traversing
+// them.
+static std::vector<FunctionAST*> parseDefinitions(Parser& parser) {
+  std::vector<FunctionAST*> fns;
+  while (parser.curTok != tok_eof) {
+    if (parser.curTok != tok_def) {
+      parser.getNextToken();
+    } else if (FunctionAST* fn = parser.parseDefinition()) {
+      fns.push_back(fn);
+    } else {
+      parser.getNextToken();
+    }
+  }
+  return fns;
+}
+
+// Parses and traverses deeply nested input at a quarter, half and all of
+// `depth`; the parser and the traversal keep their state on the heap, so
+// the time should grow linearly and nothing should overflow the stack.
+static void benchNesting(std::size_t depth) {
+  for (const char* kind : {"parens", "unary", "sequence", "if", "call"}) {
+    for (std::size_t d : {depth / 4, depth / 2, depth}) {
+      std::string path =
+          writeSource("fa_bench_nesting.txt", nestedSource(kind, d));
+      BenchSession bench;
+      AnalysisSession& session = bench.session;
+
+      auto t0 = std::chrono::steady_clock::now();
+      bench.open(path);
+      double lexSecs = secondsSince(t0);
+
+      t0 = std::chrono::steady_clock::now();
+      FunctionAST* fn = session.parser.parseDefinition();
+      double parseSecs = secondsSince(t0);
+      if (!fn) {
+        std::printf("%-8s depth %8zu: parse failed\n", kind, d);
+        std::exit(1);
+      }
+
+      t0 = std::chrono::steady_clock::now();
+      session.traverseDefinition(fn);
+      double traverseSecs = secondsSince(t0);
+
+      std::printf(
+          "%-8s depth %8zu: lex %.3f s, parse %.3f s, traverse+print "
+          "%.3f s (%.0f ns/level)\n",
+          kind, d, lexSecs, parseSecs, traverseSecs,
+          (parseSecs + traverseSecs) / d * 1e9);
+    }
+  }
+}
+
+// `defs` definitions mixing every construct, each calling earlier ones.
+static std::string largeProgram(std::size_t defs) {
+  std::string text;
+  for (std::size_t i = 0; i < defs; i++) {
+    std::string f = "f" + std::to_string(i);
+    std::string g = "f" + std::to_string(i / 2);
+    std::string h = "f" + std::to_string(i / 3);
+    text += "def " + f + "(a, b) if a < b then (" + g +
+            "(a, b) + a * 2) else (var t = a - b in t * " + h +
+            "(t, 1)) : for k = 1 when k < a inc 1 do (a + k * -b);\n";
+  }
+  return text;
+}
+
+// Times the passes over a large program one at a time: parsing, the
+// traversal that builds the IR and control edges, printing the IR and
+// building the flow graph.
+static void benchPasses(std::size_t defs) {
+  std::string path = writeSource("fa_bench_passes.txt", largeProgram(defs));
+  BenchSession bench;
+  AnalysisSession& session = bench.session;
+  session.emitIR = false;
+  bench.open(path);
+
+  auto t0 = std::chrono::steady_clock::now();
+  std::vector<FunctionAST*> fns = parseDefinitions(session.parser);
+  double parseSecs = secondsSince(t0);
+
+  t0 = std::chrono::steady_clock::now();
+  for (FunctionAST* fn : fns) {
+    session.traverseDefinition(fn);
+  }
+  double traverseSecs = secondsSince(t0);
+
+  t0 = std::chrono::steady_clock::now();
+  for (const IRFunction& fn : session.ir.functions) {
+    printIR(fn, session.symbols, session.out);
+  }
+  session.out.flush();
+  double printSecs = secondsSince(t0);
+
+  t0 = std::chrono::steady_clock::now();
+  session.flowGraph.build(session.definedFunctions);
+  double flowSecs = secondsSince(t0);
+
+  std::printf(
+      "%zu definitions, %zu flow graph nodes: parse %.3f s, traverse "
+      "%.3f s, print %.3f s, flow graph %.3f s\n",
+      fns.size(), session.flowGraph.size(), parseSecs, traverseSecs,
+      printSecs, flowSecs);
+}
+
+// `calls` ifs in main whose then branch calls h, plus as many unused
+// functions doing the same. Every return from h in the -c walk lands in a
+// different IfCont, and the walk itself stays linear in `calls`.
+static std::string returnsProgram(std::size_t calls) {
+  std::string text = "def h(x) x;\n";
+  for (std::size_t i = 0; i < calls; i++) {
+    text += "def g" + std::to_string(i) + "(a) if (a < " +
+            std::to_string(i) + ") then (h(a)) else (a);\n";
+  }
+  text += "def main(a)";
+  for (std::size_t i = 0; i < calls; i++) {
+    text += i ? " :\n  " : "\n  ";
+    text += "if (a < " + std::to_string(i) + ") then (h(a)) else (a)";
+  }
+  text += ";\n";
+  return text;
+}
+
+// Times the -c walk (flow graph build included) as the number of calls
+// returning into if joins doubles; the time per call should stay flat.
+static void benchReturns(std::size_t calls) {
+  for (std::size_t n : {calls / 4, calls / 2, calls}) {
+    std::string path =
+        writeSource("fa_bench_returns.txt", returnsProgram(n));
+    std::unique_ptr<BenchSession> bench = loadSession(path);
+    AnalysisSession& session = bench->session;
+
+    auto t0 = std::chrono::steady_clock::now();
+    session.printControlFlow();
+    session.out.flush();
+    double secs = secondsSince(t0);
+    std::printf("%8zu calls: %.3f s, %.1f ns/call, %zu bytes of report\n",
+                n, secs, secs * 1e9 / n, session.out.bytesWritten());
+  }
+}
+
+// Times -e on a main of `ifs` ifs in a row (2^ifs paths) with 1, 2, 4, ...
+// workers, up to the number of hardware threads.
+static void benchExplore(std::size_t ifs) {
+  std::string text = "def main(a)";
+  for (std::size_t i = 0; i < ifs; i++) {
+    text += i ? " :\n  " : "\n  ";
+    text += "if (a < " + std::to_string(i) + ") then (a) else (a + 1)";
+  }
+  text += ";\n";
+  std::string path = writeSource("fa_bench_explore.txt", text);
+  unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+  for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+    std::unique_ptr<BenchSession> bench = loadSession(path);
+    AnalysisSession& session = bench->session;
+
+    auto t0 = std::chrono::steady_clock::now();
+    session.printAllPaths(threads);
+    session.out.flush();
+    double secs = secondsSince(t0);
+    std::printf("%3u threads: %.3f s, %.1f ns/path, %zu bytes of report\n",
+                threads, secs, secs * 1e9 / std::ldexp(1.0, ifs),
+                session.out.bytesWritten());
+  }
+}
+
+// Times -r with 1, 2, 4, ... workers on the returns program with 16000
+// calls, whose walks are about 40000 blocks long.
+static void benchSamples(std::size_t walks) {
+  std::string path =
+      writeSource("fa_bench_samples.txt", returnsProgram(16000));
+  unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+  std::string request = std::to_string(walks);
+  for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+    std::unique_ptr<BenchSession> bench = loadSession(path);
+    AnalysisSession& session = bench->session;
+
+    auto t0 = std::chrono::steady_clock::now();
+    session.printPathSamples(request, threads);
+    session.out.flush();
+    double secs = secondsSince(t0);
+    std::printf("%3u threads: %.3f s, %.1f us/walk\n", threads, secs,
+                secs * 1e6 / walks);
+  }
+}
+
+// A main of about `blocks` IR blocks in three shapes: ifs in a row (a
+// shallow, wide tree), ifs nested in their then branches (a tree as deep
+// as the function) and loops nested in each other's bodies (every header a
+// join with a back edge). Times both trees with their frontiers, then a
+// million random dominates() queries.
+static void benchDominators(std::size_t blocks) {
+  for (const char* shape : {"chain", "nested", "loops"}) {
+    std::string text = "def main(a)\n  ";
+    std::string shapeName = shape;
+    if (shapeName == "chain") {
+      // cond, then, else and join: three new blocks per if.
+      for (std::size_t i = 0; i < blocks / 3; i++) {
+        text += i ? " :\n  " : "";
+        text += "if (a < " + std::to_string(i) + ") then (a) else (a + 1)";
+      }
+    } else if (shapeName == "nested") {
+      for (std::size_t i = 0; i < blocks / 3; i++) {
+        text += "if a < " + std::to_string(i) + " then (";
+      }
+      text += "a";
+      for (std::size_t i = 0; i < blocks / 3; i++) {
+        text += ") else (a)";
+      }
+    } else {
+      // header, body, step and exit: four new blocks per loop.
+      for (std::size_t i = 0; i < blocks / 4; i++) {
+        text += "for i = 1 when i < a inc 1 do (";
+      }
+      text += "a";
+      for (std::size_t i = 0; i < blocks / 4; i++) {
+        text += ")";
+      }
+    }
+    text += ";\n";
+    std::string path = writeSource("fa_bench_dominators.txt", text);
+    std::unique_ptr<BenchSession> bench = loadSession(path);
+    AnalysisSession& session = bench->session;
+    const IRFunction& fn = session.ir.functions.back();
+    std::size_t n = fn.blocks.size();
+
+    auto t0 = std::chrono::steady_clock::now();
+    DominatorTree dom(fn, DominatorTree::Dominators);
+    double domSecs = secondsSince(t0);
+    t0 = std::chrono::steady_clock::now();
+    DominatorTree postDom(fn, DominatorTree::PostDominators);
+    double postSecs = secondsSince(t0);
+
+    constexpr std::size_t queries = 1000000;
+    std::uint64_t x = 1;
+    std::size_t yes = 0;
+    t0 = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < queries; i++) {
+      x = x * 6364136223846793005ull + 1442695040888963407ull;
+      auto a = static_cast<std::uint32_t>((x >> 33) % n);
+      auto b = static_cast<std::uint32_t>((x >> 11) % n);
+      yes += dom.dominates(a, b) + postDom.dominates(a, b);
+    }
+    double querySecs = secondsSince(t0);
+
+    std::uint32_t depth = 0;
+    for (std::uint32_t b = 0; b < n; b++) {
+      depth = std::max(depth, dom.depth(b));
+    }
+    std::printf(
+        "%-6s %8zu blocks, depth %7u: dominators %.3f s, post-dominators "
+        "%.3f s (%.0f ns/block), %.1f ns/query (%zu true)\n",
+        shape, n, depth, domSecs, postSecs,
+        (domSecs + postSecs) / (2 * n) * 1e9,
+        querySecs / (2 * queries) * 1e9, yes);
+  }
+}
+
+// A write to the loop variable in the body of a for loop must reach the
+// next check of the condition through the step, and the variable's first
+// read must not count as a write that hides it. Exits when it does not.
+static void checkLoopWrites() {
+  std::string path =
+      writeSource("fa_bench_loopvar.txt",
+                  "def h(x) for k = 0 when k < x inc 1 do (k = k + 1);\n");
+  std::unique_ptr<BenchSession> bench = loadSession(path);
+  const IRFunction& fn = bench->session.ir.functions.back();
+  FunctionVariables vars(fn);
+  BitSolution reaching = reachingDefinitions(fn, vars);
+  DefUseChains chains(fn, vars, reaching);
+  std::filesystem::remove(path);
+
+  using Definition = FunctionVariables::Definition;
+  std::span<const Definition> defs = vars.definitions();
+  std::span<const FunctionVariables::Use> uses = vars.uses();
+  std::uint32_t store = FunctionVariables::noInst;
+  std::uint32_t step = FunctionVariables::noInst;
+  for (std::uint32_t d = 0; d < defs.size(); d++) {
+    if (defs[d].kind == Definition::LoopStep) step = d;
+    if (defs[d].kind == Definition::Write &&
+        fn.insts[defs[d].inst].op == IROpcode::Binary) {
+      store = d;
+    }
+  }
+  // The step reads the store at the end of the latch, and its write is
+  // what the condition sees after the first run.
+  bool stepReadsStore = false;
+  bool condSeesStep = false;
+  if (store != FunctionVariables::noInst &&
+      step != FunctionVariables::noInst) {
+    const IRInstruction& loop = fn.insts[defs[step].inst];
+    std::uint32_t condId = fn.operandsOf(loop)[1].index;
+    std::uint32_t cond = fn.valueInsts[condId - fn.firstId];
+    for (std::uint32_t u : chains.usesOf(store)) {
+      stepReadsStore |= uses[u].block == defs[step].block &&
+                        uses[u].inst == defs[step].inst;
+    }
+    for (std::uint32_t u = 0; u < uses.size(); u++) {
+      if (uses[u].inst != cond) continue;
+      std::span<const std::uint32_t> seen = chains.definitionsOf(u);
+      condSeesStep |= std::find(seen.begin(), seen.end(), step) != seen.end();
+    }
+  }
+  if (!stepReadsStore || !condSeesStep) {
+    std::printf("loop variable: the body's write does not reach the "
+                "condition\n");
+    std::exit(1);
+  }
+}
+
+// A main of about `blocks` IR blocks that keeps assigning its parameters,
+// with loops in a row and with nests of ten loops, each in the body of the
+// one before, in a row; a sweep of the worklist brings definitions out of
+// one level of nesting. Times liveness, reaching definitions and the
+// def-use chains, after checkLoopWrites.
+static void benchDataflow(std::size_t blocks) {
+  checkLoopWrites();
+  for (const char* shape : {"row", "nested"}) {
+    std::size_t depth = std::string(shape) == "row" ? 1 : 10;
+    // The loop's header, body, step and exit blocks and the if's then,
+    // else and join blocks: seven new blocks per loop.
+    std::size_t loops = blocks / 7 / depth * depth;
+    std::string text = "def main(a, b, c)\n  ";
+    for (std::size_t i = 0; i < loops; i++) {
+      text += "for i = 1 when i < a inc 1 do (b = b + i : "
+              "if b < c then (c = a) else (a = b) :\n  ";
+      if (i % depth == depth - 1) {
+        text += "a" + std::string(depth, ')') + " :\n  ";
+      }
+    }
+    text += "a + b + c;\n";
+    std::string path = writeSource("fa_bench_dataflow.txt", text);
+    std::unique_ptr<BenchSession> bench = loadSession(path);
+    AnalysisSession& session = bench->session;
+    const IRFunction& fn = session.ir.functions.back();
+    std::size_t n = fn.blocks.size();
+
+    auto t0 = std::chrono::steady_clock::now();
+    FunctionVariables vars(fn);
+    double varSecs = secondsSince(t0);
+    t0 = std::chrono::steady_clock::now();
+    BitSolution live = liveVariables(fn, vars);
+    double liveSecs = secondsSince(t0);
+    t0 = std::chrono::steady_clock::now();
+    BitSolution reaching = reachingDefinitions(fn, vars);
+    double reachingSecs = secondsSince(t0);
+    t0 = std::chrono::steady_clock::now();
+    DefUseChains chains(fn, vars, reaching);
+    double chainSecs = secondsSince(t0);
+
+    std::printf(
+        "%-6s %7zu blocks, %6zu defs, %6zu uses: variables %.3f s, "
+        "liveness %.3f s (%u passes, %llu visits), reaching %.3f s (%u "
+        "passes, %llu visits), chains %.3f s (%zu pairs)\n",
+        shape, n, vars.definitions().size(), vars.uses().size(), varSecs,
+        liveSecs, live.passes,
+        static_cast<unsigned long long>(live.visits), reachingSecs,
+        reaching.passes, static_cast<unsigned long long>(reaching.visits),
+        chainSecs, chains.size());
+  }
+}
+
+// A main of about `blocks` IR blocks made of for loops with constant
+// bounds, in a row and nested in one another. Times the dominator tree the
+// loops are found with and the loop forest with its trip counts.
+static void benchLoops(std::size_t blocks) {
+  for (const char* shape : {"row", "nested"}) {
+    bool nested = std::string(shape) == "nested";
+    // header, body, step and exit: four new blocks per loop.
+    std::size_t loops = blocks / 4;
+    std::string text = "def main(a)\n  ";
+    for (std::size_t i = 0; i < loops; i++) {
+      text += "for i = 0 when i < " + std::to_string(i % 97 + 1) +
+              " inc 1 do (";
+      if (!nested) text += "a) :\n  ";
+    }
+    text += "a";
+    if (nested) text += std::string(loops, ')');
+    text += ";\n";
+    std::string path = writeSource("fa_bench_loops.txt", text);
+    std::unique_ptr<BenchSession> bench = loadSession(path);
+    AnalysisSession& session = bench->session;
+    const IRFunction& fn = session.ir.functions.back();
+    std::size_t n = fn.blocks.size();
+
+    auto t0 = std::chrono::steady_clock::now();
+    DominatorTree dom(fn, DominatorTree::Dominators);
+    double domSecs = secondsSince(t0);
+    t0 = std::chrono::steady_clock::now();
+    LoopForest forest(fn, dom);
+    double forestSecs = secondsSince(t0);
+
+    std::uint32_t depth = 0;
+    std::size_t counted = 0;
+    for (const LoopForest::Loop& loop : forest.loops()) {
+      depth = std::max(depth, loop.depth);
+      counted += loop.trips.kind == TripCount::Exact;
+    }
+    std::printf(
+        "%-6s %8zu blocks, %7zu loops, depth %7u: dominators %.3f s, "
+        "loops %.3f s (%.0f ns/block), %zu trip counts\n",
+        shape, n, forest.loops().size(), depth, domSecs, forestSecs,
+        forestSecs / n * 1e9, counted);
+  }
+}
+
+// A program of `n` units of one shape: statements in a row, levels of if
+// nesting, definitions each calling one with half its index, or calls from
+// main to as many functions that all call the same leaf.
+static std::string complexityProgram(const std::string& shape,
+                                     std::size_t n) {
+  std::string text;
+  if (shape == "chain") {
+    text = "def main(a)\n  a = a + 1";
+    for (std::size_t i = 1; i < n; i++) {
+      text += i % 2 ? " :\n  a = a * 2" : " :\n  a = a + 1";
+    }
+    text += ";\n";
+  } else if (shape == "ifs") {
+    text = nestedSource("if", n);
+  } else if (shape == "functions") {
+    for (std::size_t i = 0; i < n; i++) {
+      text += "def f" + std::to_string(i) + "(a) if a < " +
+              std::to_string(i) + " then (" +
+              (i ? "f" + std::to_string(i / 2) + "(a - 1)" : "a") +
+              ") else (a + 1);\n";
+    }
+    text += "def main(a) f" + std::to_string(n - 1) + "(a);\n";
+  } else {
+    text = "def h(a) a * 2;\n";
+    for (std::size_t i = 0; i < n; i++) {
+      text += "def g" + std::to_string(i) + "(a) h(a) + " +
+              std::to_string(i) + ";\n";
+    }
+    text += "def main(a)";
+    for (std::size_t i = 0; i < n; i++) {
+      text += (i ? " :\n  g" : "\n  g") + std::to_string(i) + "(a)";
+    }
+    text += ";\n";
+  }
+  return text;
+}
+
+constexpr std::array<const char*, 5> complexityPhases = {
+    "lex", "parse", "traverse", "control", "functions"};
+
+// Seconds spent in each phase of a default `-c -f` run over `text`: lexing
+// the file, parsing every definition, the traversal (with the IR printed),
+// the -c walk and the -f report. Output goes to /dev/null.
+static std::array<double, 5> timePhases(const std::string& text) {
+  std::string path = writeSource("fa_bench_complexity.txt", text);
+  std::array<double, 5> secs{};
+  BenchSession bench;
+  AnalysisSession& session = bench.session;
+
+  auto t0 = std::chrono::steady_clock::now();
+  bench.open(path);
+  secs[0] = secondsSince(t0);
+
+  t0 = std::chrono::steady_clock::now();
+  std::vector<FunctionAST*> fns = parseDefinitions(session.parser);
+  secs[1] = secondsSince(t0);
+
+  t0 = std::chrono::steady_clock::now();
+  for (FunctionAST* fn : fns) {
+    session.traverseDefinition(fn);
+  }
+  session.out.flush();
+  secs[2] = secondsSince(t0);
+
+  t0 = std::chrono::steady_clock::now();
+  session.printControlFlow();
+  session.out.flush();
+  secs[3] = secondsSince(t0);
+
+  t0 = std::chrono::steady_clock::now();
+  session.printFuncCat();
+  session.out.flush();
+  secs[4] = secondsSince(t0);
+  return secs;
+}
+
+// Least-squares slope of log(seconds) against log(size): the k of a phase
+// that takes c * n^k. Timings under 10 us are mostly noise and left out;
+// NaN when fewer than two points remain.
+static double growthExponent(const std::vector<std::size_t>& sizes,
+                             const std::vector<double>& secs) {
+  double sx = 0, sy = 0, sxx = 0, sxy = 0;
+  std::size_t points = 0;
+  for (std::size_t i = 0; i < sizes.size(); i++) {
+    if (secs[i] < 1e-5) continue;
+    double x = std::log(static_cast<double>(sizes[i]));
+    double y = std::log(secs[i]);
+    sx += x;
+    sy += y;
+    sxx += x * x;
+    sxy += x * y;
+    points++;
+  }
+  if (points < 2) return std::nan("");
+  return (points * sxy - sx * sy) / (points * sxx - sx * sx);
+}
+
+// Times every phase on each shape of complexityProgram() at sizes doubling
+// from size / 32 up to `size`, keeping the best of three runs, and fits
+// the growth exponent of each phase. The table goes to stdout, and the
+// timings to complexity.csv and complexity.json in the working directory
+// for time_complexity/TimeComplexityGraph.py to plot.
+static void benchComplexity(std::size_t size) {
+  constexpr int repeats = 3;
+  std::ofstream csv("complexity.csv");
+  std::ofstream json("complexity.json");
+  csv << "shape,size,bytes";
+  for (const char* phase : complexityPhases) csv << ',' << phase;
+  csv << '\n';
+  json << "{\"repeats\": " << repeats << ", \"shapes\": [";
+
+  const char* shapes[] = {"chain", "ifs", "functions", "fanout"};
+  for (const char* shape : shapes) {
+    std::vector<std::size_t> sizes;
+    std::vector<std::size_t> bytes;
+    std::vector<std::vector<double>> secs(complexityPhases.size());
+    for (std::size_t n = std::max<std::size_t>(size / 32, 1); n <= size;
+         n *= 2) {
+      std::string text = complexityProgram(shape, n);
+      std::array<double, 5> best;
+      best.fill(INFINITY);
+      for (int r = 0; r < repeats; r++) {
+        std::array<double, 5> run = timePhases(text);
+        for (std::size_t p = 0; p < best.size(); p++) {
+          best[p] = std::min(best[p], run[p]);
+        }
+      }
+      sizes.push_back(n);
+      bytes.push_back(text.size());
+      csv << shape << ',' << n << ',' << text.size();
+      std::printf("%-9s %7zu:", shape, n);
+      for (std::size_t p = 0; p < best.size(); p++) {
+        secs[p].push_back(best[p]);
+        csv << ',' << best[p];
+        std::printf(" %s %.4f s%s", complexityPhases[p], best[p],
+                    p + 1 < best.size() ? "," : "\n");
+      }
+      csv << '\n';
+    }
+
+    std::printf("%-9s exponents:", shape);
+    json << (shape == shapes[0] ? "\n" : ",\n") << "  {\"shape\": \""
+         << shape << "\", \"sizes\": [";
+    for (std::size_t i = 0; i < sizes.size(); i++) {
+      json << (i ? ", " : "") << sizes[i];
+    }
+    json << "], \"bytes\": [";
+    for (std::size_t i = 0; i < bytes.size(); i++) {
+      json << (i ? ", " : "") << bytes[i];
+    }
+    json << "], \"phases\": {";
+    for (std::size_t p = 0; p < complexityPhases.size(); p++) {
+      double k = growthExponent(sizes, secs[p]);
+      std::printf(" %s %.2f%s", complexityPhases[p], k,
+                  p + 1 < complexityPhases.size() ? "," : "\n");
+      json << (p ? ",\n" : "\n") << "    \"" << complexityPhases[p]
+           << "\": {\"seconds\": [";
+      for (std::size_t i = 0; i < secs[p].size(); i++) {
+        json << (i ? ", " : "") << secs[p][i];
+      }
+      json << "], \"exponent\": ";
+      if (std::isnan(k)) {
+        json << "null";
+      } else {
+        json << k;
+      }
+      json << '}';
+    }
+    json << "}}";
+  }
+  json << "\n]}\n";
+  std::printf("wrote complexity.csv and complexity.json\n");
+}
+
+static std::string readFile(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(in), {});
+}
+
+// Checks the binary IR format end to end on largeProgram(defs) with a
+// main: the IR and the -c and -f reports are written once as text and once
+// as a binary stream (-b), the stream is turned back into text with
+// decodeBinaryIR(), and the two texts must be the same. Exits with 1 when
+// they are not.
+static void benchBinary(std::size_t defs) {
+  std::string path = writeSource(
+      "fa_bench_binary.txt",
+      largeProgram(defs) + "def main(a) f" + std::to_string(defs - 1) +
+          "(a, 1);\n");
+  auto tmp = std::filesystem::temp_directory_path();
+  std::string textPath = (tmp / "fa_bench_binary.out").string();
+  std::string binaryPath = (tmp / "fa_bench_binary.bin").string();
+  std::string decodedPath = (tmp / "fa_bench_binary.dec").string();
+
+  auto write = [&](IRWriter::Format format, const std::string& outPath) {
+    BenchSession bench(outPath);
+    AnalysisSession& session = bench.session;
+    session.out.setFormat(format);
+    bench.open(path);
+    auto t0 = std::chrono::steady_clock::now();
+    traverseDefinitions(session);
+    session.printControlFlow();
+    session.printFuncCat();
+    session.out.flush();
+    return secondsSince(t0);
+  };
+  double textSecs = write(IRWriter::Format::Text, textPath);
+  double binarySecs = write(IRWriter::Format::Binary, binaryPath);
+
+  std::string binary = readFile(binaryPath);
+  double decodeSecs;
+  bool decoded;
+  {
+    SymbolTable symbols;
+    OutputFile output(decodedPath);
+    IRWriter out(symbols, output.fd);
+    auto t0 = std::chrono::steady_clock::now();
+    decoded = decodeBinaryIR(binary, symbols, out);
+    out.flush();
+    decodeSecs = secondsSince(t0);
+  }
+  std::string text = readFile(textPath);
+  bool same = decoded && readFile(decodedPath) == text;
+  for (const std::string& file : {textPath, binaryPath, decodedPath}) {
+    std::filesystem::remove(file);
+  }
+
+  std::printf(
+      "%zu definitions: text %zu bytes in %.3f s, binary %zu bytes in %.3f "
+      "s (%.1f%%), decoded in %.3f s: %s\n",
+      defs, text.size(), textSecs, binary.size(), binarySecs,
+      100.0 * binary.size() / text.size(), decodeSecs,
+      !decoded ? "malformed stream" : same ? "round trip ok" : "MISMATCH");
+  if (!same) std::exit(1);
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::cout << "usage: " << argv[0] << " <benchmark> [size]" << std::endl;
+    return 1;
+  }
+  std::string which = argv[1];
+  std::size_t size = argc > 2 ? std::strtoul(argv[2], nullptr, 10)
+                   : which == "nesting"    ? 1000000
+                   : which == "passes"     ? 200000
+                   : which == "returns"    ? 16000
+                   : which == "explore"    ? 20
+                   : which == "samples"    ? 2000
+                   : which == "dominators" ? 300000
+                   : which == "dataflow"   ? 20000
+                   : which == "loops"      ? 300000
+                   : which == "complexity" ? 16384
+                   : which == "binary"     ? 20000
+                                           : 64;
+
+  if (which == "keywords") {
+    benchKeywords(size);
+  } else if (which == "comments") {
+    benchComments(size);
+  } else if (which == "literals") {
+    benchLiterals(size);
+  } else if (which == "nesting") {
+    benchNesting(size);
+  } else if (which == "passes") {
+    benchPasses(size);
+  } else if (which == "returns") {
+    benchReturns(size);
+  } else if (which == "explore") {
+    benchExplore(size);
+  } else if (which == "samples") {
+    benchSamples(size);
+  } else if (which == "dominators") {
+    benchDominators(size);
+  } else if (which == "dataflow") {
+    benchDataflow(size);
+  } else if (which == "loops") {
+    benchLoops(size);
+  } else if (which == "complexity") {
+    benchComplexity(size);
+  } else if (which == "binary") {
+    benchBinary(size);
+  } else {
+    std::cout << "Unknown benchmark \"" << which << "\"" << std::endl;
+    return 1;
+  }
+  return 0;
+}
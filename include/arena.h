@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <utility>
+
+// Bump allocator for everything that lives exactly as long as one
+// compilation unit: the AST nodes and the vectors hanging off them. Objects
+// are never destroyed one by one; release() drops the whole unit at once,
+// so nothing placed here may own memory outside the arena.
+class Arena : public std::pmr::memory_resource {
+ public:
+  explicit Arena(std::size_t blockSize = 1 << 16) : blockSize(blockSize) {}
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+  ~Arena() override { release(); }
+
+  template <typename T, typename... Args>
+  T* make(Args&&... args) {
+    void* mem = allocate(sizeof(T), alignof(T));
+    return new (mem) T(std::forward<Args>(args)...);
+  }
+
+  void release() {
+    while (head) {
+      Block* next = head->next;
+      ::operator delete(head);
+      head = next;
+    }
+    cur = end = nullptr;
+    used = reserved = 0;
+    blocks = 0;
+  }
+
+  std::size_t bytesUsed() const { return used; }
+  std::size_t bytesReserved() const { return reserved; }
+  std::size_t blockCount() const { return blocks; }
+
+ private:
+  struct Block {
+    Block* next;
+  };
+
+  void* do_allocate(std::size_t bytes, std::size_t align) override {
+    char* p = alignUp(cur, align);
+    if (!cur || p + bytes > end) {
+      // Oversized requests get a block of their own.
+      std::size_t size = sizeof(Block) + bytes + align;
+      if (size < blockSize) size = blockSize;
+      Block* block = static_cast<Block*>(::operator new(size));
+      block->next = head;
+      head = block;
+      cur = reinterpret_cast<char*>(block + 1);
+      end = reinterpret_cast<char*>(block) + size;
+      reserved += size;
+      blocks++;
+      p = alignUp(cur, align);
+    }
+    used += (p - cur) + bytes;
+    cur = p + bytes;
+    return p;
+  }
+  void do_deallocate(void*, std::size_t, std::size_t) override {}
+  bool do_is_equal(const std::pmr::memory_resource& other) const
+      noexcept override {
+    return this == &other;
+  }
+
+  static char* alignUp(char* p, std::size_t align) {
+    auto addr = reinterpret_cast<std::uintptr_t>(p);
+    return reinterpret_cast<char*>((addr + align - 1) & ~(align - 1));
+  }
+
+  std::size_t blockSize;
+  Block* head = nullptr;
+  char* cur = nullptr;
+  char* end = nullptr;
+  std::size_t used = 0;
+  std::size_t reserved = 0;
+  std::size_t blocks = 0;
+};
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <algorithm>
+#include <compare>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Unsigned integer of any size, for path counts that overflow 64 bits. Only
+// what path numbering needs: addition, subtraction, comparison and decimal
+// conversion.
+class BigUint {
+ public:
+  BigUint(std::uint64_t v = 0) {
+    for (; v; v >>= 32) limbs.push_back(static_cast<std::uint32_t>(v));
+  }
+
+  // Parses a non-empty string of decimal digits.
+  static bool parse(std::string_view text, BigUint& out) {
+    if (text.empty()) return false;
+    out = BigUint();
+    for (char c : text) {
+      if (c < '0' || c > '9') return false;
+      out.mulAdd(10, c - '0');
+    }
+    return true;
+  }
+
+  BigUint& operator+=(const BigUint& other) {
+    if (other.limbs.size() > limbs.size()) limbs.resize(other.limbs.size());
+    std::uint64_t carry = 0;
+    for (std::size_t i = 0; i < limbs.size(); i++) {
+      carry += limbs[i];
+      if (i < other.limbs.size()) carry += other.limbs[i];
+      limbs[i] = static_cast<std::uint32_t>(carry);
+      carry >>= 32;
+    }
+    if (carry) limbs.push_back(static_cast<std::uint32_t>(carry));
+    return *this;
+  }
+
+  // *this must not be less than `other`.
+  BigUint& operator-=(const BigUint& other) {
+    std::int64_t borrow = 0;
+    for (std::size_t i = 0; i < limbs.size(); i++) {
+      std::int64_t d = std::int64_t(limbs[i]) - borrow -
+                       (i < other.limbs.size() ? other.limbs[i] : 0);
+      borrow = d < 0;
+      limbs[i] = static_cast<std::uint32_t>(d + (borrow << 32));
+    }
+    trim();
+    return *this;
+  }
+
+  std::strong_ordering operator<=>(const BigUint& other) const {
+    if (limbs.size() != other.limbs.size()) {
+      return limbs.size() <=> other.limbs.size();
+    }
+    for (std::size_t i = limbs.size(); i-- > 0;) {
+      if (limbs[i] != other.limbs[i]) return limbs[i] <=> other.limbs[i];
+    }
+    return std::strong_ordering::equal;
+  }
+  bool operator==(const BigUint& other) const = default;
+
+  bool isZero() const { return limbs.empty(); }
+  // The value, or UINT64_MAX if it does not fit.
+  std::uint64_t saturated() const {
+    if (limbs.size() > 2) return ~std::uint64_t(0);
+    std::uint64_t v = 0;
+    for (std::size_t i = limbs.size(); i-- > 0;) v = v << 32 | limbs[i];
+    return v;
+  }
+
+  std::string toString() const {
+    if (limbs.empty()) return "0";
+    std::string digits;
+    BigUint rest = *this;
+    while (!rest.limbs.empty()) {
+      std::uint32_t chunk = rest.divSmall(1000000000);
+      for (int i = 0; i < 9 && (chunk || !rest.limbs.empty()); i++) {
+        digits.push_back(static_cast<char>('0' + chunk % 10));
+        chunk /= 10;
+      }
+    }
+    std::reverse(digits.begin(), digits.end());
+    return digits;
+  }
+
+ private:
+  void mulAdd(std::uint32_t mul, std::uint32_t add) {
+    std::uint64_t carry = add;
+    for (std::uint32_t& limb : limbs) {
+      carry += std::uint64_t(limb) * mul;
+      limb = static_cast<std::uint32_t>(carry);
+      carry >>= 32;
+    }
+    if (carry) limbs.push_back(static_cast<std::uint32_t>(carry));
+  }
+  // Divides in place and returns the remainder.
+  std::uint32_t divSmall(std::uint32_t div) {
+    std::uint64_t rem = 0;
+    for (std::size_t i = limbs.size(); i-- > 0;) {
+      std::uint64_t cur = rem << 32 | limbs[i];
+      limbs[i] = static_cast<std::uint32_t>(cur / div);
+      rem = cur % div;
+    }
+    trim();
+    return static_cast<std::uint32_t>(rem);
+  }
+  void trim() {
+    while (!limbs.empty() && limbs.back() == 0) limbs.pop_back();
+  }
+
+  std::vector<std::uint32_t> limbs;  // least significant first
+};
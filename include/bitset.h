@@ -0,0 +1,124 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+// Fixed-size set of small integers, one bit each, stored in 64-bit words so
+// that unions and scans handle 64 members per step.
+class DenseBitset {
+ public:
+  DenseBitset() = default;
+  explicit DenseBitset(std::size_t size)
+      : bits(size), words((size + 63) / 64, 0) {}
+
+  std::size_t size() const { return bits; }
+
+  bool test(std::size_t i) const { return words[i / 64] >> (i % 64) & 1; }
+  void set(std::size_t i) { words[i / 64] |= std::uint64_t(1) << (i % 64); }
+  void reset(std::size_t i) {
+    words[i / 64] &= ~(std::uint64_t(1) << (i % 64));
+  }
+  void clear() { words.assign(words.size(), 0); }
+  // Sets or clears every bit in [first, last).
+  void setRange(std::size_t first, std::size_t last) {
+    forRange(first, last, [](std::uint64_t& word, std::uint64_t mask) {
+      word |= mask;
+    });
+  }
+  void resetRange(std::size_t first, std::size_t last) {
+    forRange(first, last, [](std::uint64_t& word, std::uint64_t mask) {
+      word &= ~mask;
+    });
+  }
+  void setAll() {
+    words.assign(words.size(), ~std::uint64_t(0));
+    if (bits % 64) words.back() = (std::uint64_t(1) << bits % 64) - 1;
+  }
+
+  // Set union; returns whether any bit was added. Both sets must have the
+  // same size.
+  bool unionWith(const DenseBitset& other) {
+    std::uint64_t added = 0;
+    for (std::size_t w = 0; w < words.size(); w++) {
+      std::uint64_t merged = words[w] | other.words[w];
+      added |= merged ^ words[w];
+      words[w] = merged;
+    }
+    return added != 0;
+  }
+
+  // Set intersection; returns whether any bit was removed.
+  bool intersectWith(const DenseBitset& other) {
+    std::uint64_t removed = 0;
+    for (std::size_t w = 0; w < words.size(); w++) {
+      std::uint64_t kept = words[w] & other.words[w];
+      removed |= kept ^ words[w];
+      words[w] = kept;
+    }
+    return removed != 0;
+  }
+
+  // Makes this gen | (in - kill), the transfer function of a bit-vector
+  // dataflow problem, in one pass over the words; returns whether the set
+  // changed.
+  bool assignTransfer(const DenseBitset& in, const DenseBitset& gen,
+                      const DenseBitset& kill) {
+    std::uint64_t changed = 0;
+    for (std::size_t w = 0; w < words.size(); w++) {
+      std::uint64_t next = gen.words[w] | (in.words[w] & ~kill.words[w]);
+      changed |= next ^ words[w];
+      words[w] = next;
+    }
+    return changed != 0;
+  }
+
+  // Smallest member not less than `i`, or size() if there is none.
+  std::size_t findNext(std::size_t i) const {
+    if (i >= bits) return bits;
+    std::size_t w = i / 64;
+    std::uint64_t word = words[w] & (~std::uint64_t(0) << (i % 64));
+    while (!word) {
+      if (++w == words.size()) return bits;
+      word = words[w];
+    }
+    return w * 64 + std::countr_zero(word);
+  }
+
+  std::size_t count() const {
+    std::size_t n = 0;
+    for (std::uint64_t w : words) n += std::popcount(w);
+    return n;
+  }
+
+  // Calls f(i) for every member, in increasing order.
+  template <typename F>
+  void forEach(F f) const {
+    for (std::size_t w = 0; w < words.size(); w++) {
+      for (std::uint64_t word = words[w]; word; word &= word - 1) {
+        f(w * 64 + std::countr_zero(word));
+      }
+    }
+  }
+
+  bool operator==(const DenseBitset& other) const = default;
+
+ private:
+  // Calls f(word, mask) for every word overlapping [first, last), with the
+  // bits of the range in that word.
+  template <typename F>
+  void forRange(std::size_t first, std::size_t last, F f) {
+    if (first >= last) return;
+    std::size_t w = first / 64;
+    std::size_t end = (last - 1) / 64;
+    std::uint64_t mask = ~std::uint64_t(0) << (first % 64);
+    for (; w < end; w++) {
+      f(words[w], mask);
+      mask = ~std::uint64_t(0);
+    }
+    f(words[end], mask & (~std::uint64_t(0) >> (63 - (last - 1) % 64)));
+  }
+
+  std::size_t bits = 0;
+  std::vector<std::uint64_t> words;
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+
+// Limits on the work of one analysis walk. Zero means no limit.
+struct Budget {
+  std::uint64_t nodes = 0;  // nodes visited
+  std::uint64_t paths = 0;  // paths started
+  std::uint64_t bytes = 0;  // bytes of report
+  double seconds = 0;       // wall time
+
+  bool limited() const { return nodes || paths || bytes || seconds > 0; }
+};
+
+// Work done so far against a Budget.
+struct BudgetUse {
+  std::uint64_t nodes = 0;
+  std::uint64_t paths = 0;
+  std::uint64_t bytes = 0;
+  std::chrono::steady_clock::duration time{};
+
+  // Name of the first limit of `budget` this use is over, or nullptr.
+  const char* exceeded(const Budget& budget) const {
+    if (budget.nodes && nodes > budget.nodes) return "nodes";
+    if (budget.paths && paths > budget.paths) return "paths";
+    if (budget.bytes && bytes > budget.bytes) return "bytes";
+    if (budget.seconds > 0 &&
+        std::chrono::duration<double>(time).count() > budget.seconds) {
+      return "time";
+    }
+    return nullptr;
+  }
+};
+
+// The budgets of a run (-l): one for each function and one for the whole
+// walk.
+struct Budgets {
+  Budget perFunction;
+  Budget perRun;
+
+  bool limited() const { return perFunction.limited() || perRun.limited(); }
+
+  // Parses a comma-separated list of key=value, where the key is nodes,
+  // paths, bytes or time, prefixed with "fn." for the per-function budget.
+  // Counts take an optional k, M or G suffix; time is in seconds. Entries
+  // override what is already set; false if any entry is malformed.
+  bool parse(std::string_view spec) {
+    while (!spec.empty()) {
+      std::size_t comma = spec.find(',');
+      std::string_view entry = spec.substr(0, comma);
+      spec = comma == std::string_view::npos ? std::string_view()
+                                             : spec.substr(comma + 1);
+      std::size_t eq = entry.find('=');
+      if (eq == std::string_view::npos) return false;
+      std::string_view key = entry.substr(0, eq);
+      std::string_view value = entry.substr(eq + 1);
+      Budget* budget = &perRun;
+      if (key.starts_with("fn.")) {
+        budget = &perFunction;
+        key.remove_prefix(3);
+      }
+      if (key == "time") {
+        auto [end, ec] = std::from_chars(value.data(),
+                                         value.data() + value.size(),
+                                         budget->seconds);
+        if (ec != std::errc() || end != value.data() + value.size() ||
+            budget->seconds < 0) {
+          return false;
+        }
+        continue;
+      }
+      std::uint64_t* count = key == "nodes"   ? &budget->nodes
+                             : key == "paths" ? &budget->paths
+                             : key == "bytes" ? &budget->bytes
+                                              : nullptr;
+      if (!count || !parseCount(value, *count)) return false;
+    }
+    return true;
+  }
+
+ private:
+  static bool parseCount(std::string_view text, std::uint64_t& value) {
+    std::uint64_t scale = 1;
+    if (!text.empty()) {
+      switch (text.back()) {
+        case 'k': scale = 1000; break;
+        case 'M': scale = 1000000; break;
+        case 'G': scale = 1000000000; break;
+      }
+      if (scale != 1) text.remove_suffix(1);
+    }
+    auto [end, ec] =
+        std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc() || end != text.data() + text.size() ||
+        value > ~std::uint64_t(0) / scale) {
+      return false;
+    }
+    value *= scale;
+    return true;
+  }
+};
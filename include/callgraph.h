@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "../include/bitset.h"
+#include "../include/ir.h"
+#include "../include/symbols.h"
+
+using FunctionId = std::uint32_t;
+constexpr FunctionId noFunction = ~FunctionId(0);
+
+// Which defined function calls which, taken from the call instructions of
+// the IR (one per CallExprAST). A name defined more than once is its first
+// definition, as everywhere else, and a call counts whether the callee was
+// defined before or after the caller; calls to names that are never
+// defined are dropped.
+//
+// build() also condenses the graph into its strongly connected components
+// (Tarjan), so recursion collapses into one component and reachability is a
+// walk over a DAG.
+class CallGraph {
+ public:
+  void build(const std::vector<IRFunction>& functions);
+  void clear();
+
+  std::size_t size() const { return names.size(); }
+  Symbol name(FunctionId f) const { return names[f]; }
+  FunctionId find(Symbol fn) const {
+    return ids.contains(fn) ? ids.at(fn) : noFunction;
+  }
+  // Distinct callees, in order of their first call.
+  std::span<const FunctionId> callees(FunctionId f) const {
+    return {calleeList.data() + calleeOffsets[f],
+            calleeOffsets[f + 1] - calleeOffsets[f]};
+  }
+
+  // Components are numbered in reverse topological order: every call goes
+  // to the caller's own component or to a lower-numbered one.
+  std::size_t componentCount() const { return componentOffsets.size() - 1; }
+  std::uint32_t componentOf(FunctionId f) const { return components[f]; }
+  std::span<const FunctionId> members(std::uint32_t c) const {
+    return {memberList.data() + componentOffsets[c],
+            componentOffsets[c + 1] - componentOffsets[c]};
+  }
+
+  // Functions reachable from `root` through calls, `root` included, as a
+  // set of FunctionIds. Linear in the size of the graph.
+  DenseBitset reachableFrom(FunctionId root) const;
+
+ private:
+  void findComponents();
+
+  std::vector<Symbol> names;
+  SymbolMap<FunctionId> ids;
+  std::vector<std::uint32_t> calleeOffsets;
+  std::vector<FunctionId> calleeList;
+
+  std::vector<std::uint32_t> components;
+  std::vector<std::uint32_t> componentOffsets{0};
+  std::vector<FunctionId> memberList;
+};
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "../include/bitset.h"
+#include "../include/ir.h"
+
+class AnalysisSession;
+
+// A bit-vector dataflow problem over one function's IR blocks. Each block
+// maps the facts flowing into it to the facts flowing out of it by
+// gen | (facts - kill); where control flow meets, the facts of the incoming
+// edges are joined by union (a may problem) or intersection (a must
+// problem). Every set is a DenseBitset of `bits` bits, so that the meet
+// and transfer functions run a 64-bit word at a time (and vectorise); a
+// problem and its solution take four such sets per block.
+struct BitProblem {
+  enum Direction : std::uint8_t {
+    Forward,   // from a block's start to its end, along successors
+    Backward,  // from a block's end to its start, along predecessors
+  };
+  enum Meet : std::uint8_t { Union, Intersection };
+
+  Direction direction = Forward;
+  Meet meet = Union;
+  std::size_t bits = 0;
+  std::vector<DenseBitset> gen;  // per block
+  std::vector<DenseBitset> kill;
+  // Facts at the start of the entry block (forward) or at the end of the
+  // returning block (backward).
+  DenseBitset boundary;
+};
+
+struct BitSolution {
+  std::vector<DenseBitset> in;   // facts at the start of each block
+  std::vector<DenseBitset> out;  // facts at the end of each block
+  std::uint32_t passes = 0;      // sweeps through the worklist
+  std::uint64_t visits = 0;      // transfer functions applied
+};
+
+// Solves `problem` to its fixed point. The worklist is a bitset over the
+// blocks' positions in reverse postorder (of the reversed graph, for a
+// backward problem), swept from the first pending position to the last:
+// a block whose facts change puts the blocks it flows into back on the
+// list, and those after it are reached in the same sweep. Acyclic code
+// settles in one sweep, and facts only need another sweep to cross a loop
+// back edge, so loops nested d deep take at most d + 2. Blocks that cannot
+// be reached in the problem's direction keep empty sets.
+extern BitSolution solveBitProblem(const IRFunction& fn,
+                                   const BitProblem& problem);
+
+// The variables of one function and where they are written and read.
+//
+// A variable is a binding: a parameter, a `var` binding or the dummy
+// declaration of an undeclared name. Every read of a variable refers to
+// the %N id of its binding, so once a binding is assigned with '=' the IR
+// alone does not say which write a read sees. A definition is the binding
+// itself or a Binary '=' whose left operand is the binding; a use is any
+// other value operand that names a binding, along with a block's branch
+// condition or return value. The operands of a phi are read at the end of
+// the branch block they come from.
+//
+// A for loop writes the binding its variable names twice: with the start
+// value at the end of the block entering the loop, and with the variable
+// plus the step at the end of the latch, after the step is read. A binding
+// made inside the loop by the variable's first use is not a definition of
+// its own, so a write in the body reaches the next check of the condition.
+// The values of the condition and body are read where they are computed,
+// not by the Loop instruction.
+class FunctionVariables {
+ public:
+  static constexpr std::uint32_t noInst = ~std::uint32_t(0);
+
+  struct Definition {
+    enum Kind : std::uint8_t {
+      Write,      // the binding or an assignment
+      LoopStart,  // `for v = start`, on entering the loop
+      LoopStep,   // `inc step`, at the end of the latch
+    };
+    std::uint32_t var;
+    std::uint32_t inst;   // the binding, the assignment or the Loop
+    std::uint32_t block;  // where the write happens
+    Kind kind;
+  };
+  struct Use {
+    std::uint32_t var;
+    std::uint32_t block;  // where the read happens
+    // The reading instruction (a phi for the operands of one), or noInst
+    // for the block's terminator.
+    std::uint32_t inst;
+  };
+  // One read or write, in program order within a block.
+  struct Event {
+    bool def;
+    std::uint32_t index;  // into definitions() or uses()
+  };
+
+  explicit FunctionVariables(const IRFunction& fn);
+
+  std::size_t size() const { return bindings.size(); }
+  // Instruction of variable v's binding.
+  std::uint32_t binding(std::uint32_t v) const { return bindings[v]; }
+  std::span<const Definition> definitions() const { return defs; }
+  std::span<const Use> uses() const { return useList; }
+  // Definitions are grouped by variable: those of variable v are
+  // [firstDefinition(v), firstDefinition(v + 1)), in program order, so
+  // that the analyses can clear or scan them a word at a time.
+  std::uint32_t firstDefinition(std::uint32_t v) const {
+    return varDefOffsets[v];
+  }
+  std::span<const Event> events(std::uint32_t block) const {
+    return {eventList.data() + eventOffsets[block],
+            eventOffsets[block + 1] - eventOffsets[block]};
+  }
+
+ private:
+  std::vector<std::uint32_t> bindings;
+  std::vector<Definition> defs;
+  std::vector<Use> useList;
+  std::vector<std::uint32_t> varDefOffsets;  // size() + 1 entries
+  std::vector<std::uint32_t> eventOffsets;  // CSR over blocks
+  std::vector<Event> eventList;
+};
+
+// Variables live at the start and end of each block: those some path from
+// there reads before writing them. A backward union problem over the
+// variables.
+extern BitSolution liveVariables(const IRFunction& fn,
+                                 const FunctionVariables& vars);
+
+// Definitions reaching the start and end of each block: those some path
+// from them gets there without another write to their variable. A forward
+// union problem over the definitions.
+extern BitSolution reachingDefinitions(const IRFunction& fn,
+                                       const FunctionVariables& vars);
+
+// Use-def and def-use chains: the definitions each use may read and the
+// uses each definition may reach, both in increasing order.
+class DefUseChains {
+ public:
+  DefUseChains(const IRFunction& fn, const FunctionVariables& vars,
+               const BitSolution& reaching);
+
+  std::span<const std::uint32_t> definitionsOf(std::uint32_t use) const {
+    return {useDefList.data() + useDefOffsets[use],
+            useDefOffsets[use + 1] - useDefOffsets[use]};
+  }
+  // Number of (use, definition) pairs.
+  std::size_t size() const { return useDefList.size(); }
+  std::span<const std::uint32_t> usesOf(std::uint32_t def) const {
+    return {defUseList.data() + defUseOffsets[def],
+            defUseOffsets[def + 1] - defUseOffsets[def]};
+  }
+
+ private:
+  std::vector<std::uint32_t> useDefOffsets;  // CSR over uses
+  std::vector<std::uint32_t> useDefList;
+  std::vector<std::uint32_t> defUseOffsets;  // CSR over definitions
+  std::vector<std::uint32_t> defUseList;
+};
+
+// Prints the -u report to session.out: for every function, its variables,
+// the live variables and reaching definitions of each block, and the
+// def-use and use-def chains.
+extern void printDataflow(AnalysisSession& session);
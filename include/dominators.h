@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "../include/ir.h"
+
+class AnalysisSession;
+
+// Dominator (or post-dominator) tree of one function's IR blocks, with the
+// dominance frontier of every block.
+//
+// Block a dominates block b if every path from the entry to b goes through
+// a; it post-dominates b if every path from b to the returning block does.
+// The tree is built with the Lengauer-Tarjan algorithm (the simple version,
+// with path compression but no balancing), in O(E log V), and the frontiers
+// with the Cooper-Harvey-Kennedy runners. Neither recurses, however deep
+// the nesting. The tree is then numbered in depth-first order, so that the
+// blocks a block dominates are one interval of numbers and dominates() is
+// two comparisons.
+//
+// Blocks that cannot be reached from the root (in the direction of the
+// tree) have no immediate dominator, dominate nothing and are dominated by
+// nothing.
+class DominatorTree {
+ public:
+  enum Kind : std::uint8_t {
+    Dominators,      // rooted at the entry, over the successor edges
+    PostDominators,  // rooted at the returning block, over predecessors
+  };
+  static constexpr std::uint32_t noBlock = ~std::uint32_t(0);
+
+  DominatorTree(const IRFunction& fn, Kind kind);
+
+  Kind kind() const { return treeKind; }
+  std::uint32_t root() const { return rootBlock; }
+  std::size_t size() const { return idoms.size(); }
+  bool reachable(std::uint32_t b) const { return enter[b] != noBlock; }
+  // Immediate (post-)dominator; noBlock for the root and unreachable
+  // blocks.
+  std::uint32_t idom(std::uint32_t b) const { return idoms[b]; }
+  // Depth in the tree; the root is at depth 0.
+  std::uint32_t depth(std::uint32_t b) const { return depths[b]; }
+  // Blocks whose immediate (post-)dominator is `b`, in increasing order.
+  std::span<const std::uint32_t> children(std::uint32_t b) const {
+    return range(childOffsets, childList, b);
+  }
+  // Blocks where the dominance of `b` ends: those with a predecessor
+  // (successor, for post-dominators) that `b` dominates while not strictly
+  // dominating the block itself. In increasing order.
+  std::span<const std::uint32_t> frontier(std::uint32_t b) const {
+    return range(frontierOffsets, frontierList, b);
+  }
+
+  bool dominates(std::uint32_t a, std::uint32_t b) const {
+    return enter[a] <= enter[b] && enter[b] < leave[a];
+  }
+  bool strictlyDominates(std::uint32_t a, std::uint32_t b) const {
+    return a != b && dominates(a, b);
+  }
+
+ private:
+  static std::span<const std::uint32_t> range(
+      const std::vector<std::uint32_t>& offsets,
+      const std::vector<std::uint32_t>& list, std::uint32_t i) {
+    return {list.data() + offsets[i], offsets[i + 1] - offsets[i]};
+  }
+
+  void build(const IRFunction& fn);
+  void number();
+  void findFrontiers(const IRFunction& fn);
+
+  Kind treeKind;
+  std::uint32_t rootBlock = 0;
+  std::vector<std::uint32_t> idoms;
+  std::vector<std::uint32_t> depths;
+  // Depth-first numbering of the tree: the subtree of b is numbered
+  // [enter[b], leave[b]). Unreachable blocks get noBlock for both, which
+  // makes every query about them false.
+  std::vector<std::uint32_t> enter;
+  std::vector<std::uint32_t> leave;
+  std::vector<std::uint32_t> childOffsets;  // CSR over blocks
+  std::vector<std::uint32_t> childList;
+  std::vector<std::uint32_t> frontierOffsets;
+  std::vector<std::uint32_t> frontierList;
+};
+
+// Prints the -t report to session.out: for every function, the immediate
+// dominator and post-dominator of each block and its two frontiers.
+extern void printDominatorTrees(AnalysisSession& session);
@@ -0,0 +1,15 @@
+#pragma once
+
+class AnalysisSession;
+
+// Prints the -e report to session.out: every numbered path (see
+// PathNumbering) of every function, in path id order.
+//
+// Each function is explored depth first from its entry. Where a block still
+// has many paths below it, the edges after the first are forked off as
+// tasks into a work-stealing pool of `threads` workers. The paths below an
+// edge have consecutive ids, so every worker writes what it finds into its
+// own buffers, each tagged with the id of its first path, and sorting the
+// buffers by function and id gives the same report for any number of
+// threads.
+extern void explorePaths(AnalysisSession& session, unsigned threads);
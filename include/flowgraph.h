@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "../include/symbols.h"
+
+class AnalysisSession;
+class FunctionAST;
+
+// Tag for every concrete node type; IfCont is the join node IfExprAST
+// creates and Expr is a plain ExprAST.
+enum class NodeKind : unsigned char {
+  Expr,
+  Number,
+  Variable,
+  Var,
+  Binary,
+  Unary,
+  Prototype,
+  Function,
+  Call,
+  If,
+  IfCont,
+  For,
+};
+
+using NodeId = std::uint32_t;
+constexpr NodeId noNode = ~NodeId(0);
+using BlockId = std::uint32_t;
+
+// Flat, index-based control-flow graph of the flow-augmented AST, built once
+// every definition has been traversed. Each node is a NodeKind, one 32-bit
+// payload and its control edges in their original order; the pointer-heavy
+// ExprAST objects are not touched again by the analyses that run on it.
+//
+// Nodes are grouped into basic blocks: maximal chains in which every node
+// but the last has exactly one successor and every node but the first has
+// exactly one predecessor. A function's last node always ends its block,
+// since the walk treats it specially. The nodes of a block have consecutive
+// ids, so the successor of a node inside a block is the next id.
+// Successors and predecessors of nodes and of blocks are stored as CSR
+// arrays (one offset array plus one flat edge array each).
+//
+// Payload by kind:
+//   Number                       index into numbers()
+//   Variable, Prototype, Call    Symbol of the name / callee
+//   Function                     Symbol of the function name
+//   Binary, Unary                the operator character
+//   If                           line of the condition's first node
+class FlowGraph {
+ public:
+  void build(const SymbolMap<FunctionAST*>& definedFunctions);
+  void clear();
+
+  std::size_t size() const { return kinds.size(); }
+  NodeKind kind(NodeId n) const { return kinds[n]; }
+  std::uint32_t payload(NodeId n) const { return payloads[n]; }
+  int line(NodeId n) const { return lines[n]; }
+  bool isFuncEnd(NodeId n) const { return funcEnds[n] != noFunc; }
+  // Function whose body ends at `n`; only meaningful when isFuncEnd(n).
+  Symbol funcEnd(NodeId n) const { return funcEnds[n]; }
+  // Function whose body `n` is in.
+  Symbol owner(NodeId n) const { return owners[n]; }
+  double number(NodeId n) const { return numbers[payloads[n]]; }
+
+  std::span<const NodeId> succs(NodeId n) const {
+    return range(succOffsets, succList, n);
+  }
+  std::span<const NodeId> preds(NodeId n) const {
+    return range(predOffsets, predList, n);
+  }
+
+  std::size_t blockCount() const {
+    return blockStarts.empty() ? 0 : blockStarts.size() - 1;
+  }
+  BlockId blockOf(NodeId n) const { return blocks[n]; }
+  // Nodes of block `b` are [blockBegin(b), blockEnd(b)).
+  NodeId blockBegin(BlockId b) const { return blockStarts[b]; }
+  NodeId blockEnd(BlockId b) const { return blockStarts[b + 1]; }
+  std::span<const BlockId> blockSuccs(BlockId b) const {
+    return range(blockSuccOffsets, blockSuccList, b);
+  }
+  std::span<const BlockId> blockPreds(BlockId b) const {
+    return range(blockPredOffsets, blockPredList, b);
+  }
+
+  // FunctionAST node of a defined function, or noNode.
+  NodeId entry(Symbol fn) const {
+    return functions.contains(fn) ? functions.at(fn).entry : noNode;
+  }
+  // Last node of a defined function's body (where its calls return from),
+  // or noNode.
+  NodeId exit(Symbol fn) const {
+    return functions.contains(fn) ? functions.at(fn).exit : noNode;
+  }
+
+  std::size_t bytes() const;
+
+ private:
+  static constexpr Symbol noFunc = ~Symbol(0);
+
+  struct FunctionNodes {
+    NodeId entry;
+    NodeId exit;
+  };
+
+  static std::span<const std::uint32_t> range(
+      const std::vector<std::uint32_t>& offsets,
+      const std::vector<std::uint32_t>& list, std::uint32_t i) {
+    return {list.data() + offsets[i], offsets[i + 1] - offsets[i]};
+  }
+
+  std::vector<NodeKind> kinds;
+  std::vector<std::uint32_t> payloads;
+  std::vector<int> lines;
+  std::vector<Symbol> funcEnds;
+  std::vector<Symbol> owners;
+  std::vector<double> numbers;
+  std::vector<std::uint32_t> succOffsets;
+  std::vector<NodeId> succList;
+  std::vector<std::uint32_t> predOffsets;
+  std::vector<NodeId> predList;
+
+  std::vector<BlockId> blocks;
+  std::vector<NodeId> blockStarts;  // blockCount() + 1 entries
+  std::vector<std::uint32_t> blockSuccOffsets;
+  std::vector<BlockId> blockSuccList;
+  std::vector<std::uint32_t> blockPredOffsets;
+  std::vector<BlockId> blockPredList;
+
+  SymbolMap<FunctionNodes> functions;
+};
+
+// Prints the -c report for the walk starting at `entry` to session.out,
+// within session.budgets.
+extern void printControlFlowGraph(AnalysisSession& session, NodeId entry);
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "../include/irwriter.h"
+#include "../include/symbols.h"
+
+// In-memory IR built by the traversal, one IRFunction per definition.
+//
+// Every instruction that defines a value carries the `%N` id the traversal
+// hands out; ids are unique across the session and increase with the
+// instruction order, so each function owns a contiguous range of them.
+// A read of a variable refers to the %N id of its binding (a parameter, a
+// `var` or the dummy declaration of an undeclared name), and `x = e` is a
+// Binary '=' whose left operand is that binding. Variables get no phis, so
+// the IR is not in SSA form: which assignment a read sees is left to the
+// reaching definitions of include/dataflow.h. The only phi is the value of
+// an if-expression, in its IfCont join block; loops have none.
+enum class IROpcode : std::uint8_t {
+  Param,       // sym: argument name
+  Undeclared,  // sym: dummy declaration for a use of an unknown variable
+  Const,       // val
+  Bind,        // sym: variable declared by `var`; operands: init value
+  Binary,      // binop; operands: lhs, rhs
+  Unary,       // binop: operator; operands: operand
+  Call,        // sym: callee; operands: arguments
+  Phi,         // operands: branch block, then value, then block, else
+               // value, else block
+  Loop,        // sym: loop variable; operands: start, cond, step, body
+               // values, the block entering the loop and the latch (the
+               // end of the step), then the binding the loop variable
+               // names, when the name is bound
+  ScopeBegin,  // start of a `var ... in` scope; defines no value
+  ScopeEnd,    // end of that scope; defines no value
+};
+
+struct IROperand {
+  enum Kind : std::uint8_t { Value, Block };
+  Kind kind;
+  std::uint32_t index;  // value id or block index
+};
+
+struct IRInstruction {
+  IROpcode op;
+  char binop = 0;
+  // Call only: the callee had no definition when the call was built.
+  bool external = false;
+  int id = 0;  // 0 for ScopeBegin/ScopeEnd
+  Symbol sym = 0;
+  double val = 0;
+  std::uint32_t block = 0;
+  std::uint32_t firstOperand = 0;
+  std::uint32_t numOperands = 0;
+};
+
+enum class IRTerminator : std::uint8_t {
+  None,    // still being built
+  Br,      // succs[0]
+  CondBr,  // cond ? succs[0] : succs[1]
+  Ret,     // returns `cond`
+};
+
+// Instructions of a block are contiguous in IRFunction::insts, because the
+// traversal never returns to a block once it has moved on.
+struct IRBlock {
+  std::uint32_t firstInst = 0;
+  std::uint32_t endInst = 0;
+  IRTerminator term = IRTerminator::None;
+  int cond = 0;
+  std::vector<std::uint32_t> preds;
+  std::vector<std::uint32_t> succs;
+};
+
+struct IRFunction {
+  Symbol name = 0;
+  std::uint32_t numParams = 0;  // insts[0, numParams) are the Params
+  std::vector<IRInstruction> insts;
+  std::vector<IROperand> operands;
+  std::vector<IRBlock> blocks;  // blocks[0] is the entry
+  int firstId = 0;
+  std::vector<std::uint32_t> valueInsts;  // by id - firstId
+
+  std::span<const IROperand> operandsOf(const IRInstruction& inst) const {
+    return {operands.data() + inst.firstOperand, inst.numOperands};
+  }
+  // Instruction defining value `id`; the id must belong to this function.
+  const IRInstruction& def(int id) const {
+    return insts[valueInsts[id - firstId]];
+  }
+};
+
+// Appends instructions and blocks to the function being traversed. The
+// if/for methods are called between the traversals of the sub-expressions
+// and open the blocks the following instructions go to.
+class IRBuilder {
+ public:
+  void beginFunction(Symbol name);
+  void endFunction(int result);
+
+  void param(int id, Symbol name);
+  void undeclared(int id, Symbol name);
+  void constant(int id, double val);
+  void bind(int id, Symbol name, int init);
+  void binary(int id, char op, int lhs, int rhs);
+  void unary(int id, char op, int operand);
+  void call(int id, Symbol callee, std::span<const int> args, bool defined);
+  void scopeBegin();
+  void scopeEnd();
+
+  // cond; beginThen(cond); then; beginElse(); else; endIf(...)
+  void beginThen(int cond);
+  void beginElse();
+  void endIf(int id, int thenValue, int elseValue);
+
+  // start; beginLoop(); cond; beginLoopBody(cond); body; beginLoopStep();
+  // step; endLoop(...)
+  void beginLoop();
+  void beginLoopBody(int cond);
+  void beginLoopStep();
+  // `binding` is the id of the binding `var` names, or 0 when it names none.
+  void endLoop(int id, Symbol var, int start, int cond, int step, int body,
+               int binding);
+
+  std::vector<IRFunction> functions;
+
+ private:
+  IRFunction& fn() { return functions.back(); }
+  IRInstruction& append(IROpcode op, int id);
+  void operand(IROperand::Kind kind, std::uint32_t index);
+  std::uint32_t newBlock();
+  void setBlock(std::uint32_t block);
+  void branch(std::uint32_t to);
+
+  std::uint32_t cur = 0;
+  // Blocks of the enclosing ifs and loops that are still open.
+  std::vector<std::uint32_t> pending;
+};
+
+// Prints `fn` in the text (or binary) form of the IR: the traversal header
+// and every instruction in order.
+extern void printIR(const IRFunction& fn, const SymbolTable& symbols,
+                    IRWriter& out);
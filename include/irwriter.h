@@ -0,0 +1,140 @@
+#pragma once
+
+#include <unistd.h>
+
+#include <charconv>
+#include <concepts>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../include/symbols.h"
+
+// Output stream for the IR and the reports. Everything is formatted with
+// std::to_chars into one reusable buffer that is handed to write(2) in
+// large chunks; nothing is flushed per line. Call flush() before writing to
+// the same file descriptor through anything else.
+//
+// The instruction methods (constant(), binary(), ...) produce the familiar
+// `%7 = %3 + %5` lines in Text format. In Binary format they produce one
+// record each instead, and any plain text written with << is carried in
+// Text records, so the whole output stays one well-formed stream:
+//
+//   stream  := "FAIR" version:u8 record*
+//   record  := op:u8 operands
+//
+// Integers are unsigned LEB128, doubles 8 bytes IEEE-754 little endian,
+// operator characters one byte. A Name record binds a Symbol to its
+// spelling before the first record that refers to it. See IROp for the
+// operands of each record.
+class IRWriter {
+ public:
+  enum class Format : unsigned char { Text, Binary };
+
+  // Operands, in order, follow each opcode.
+  enum IROp : std::uint8_t {
+    op_text,      // length, bytes
+    op_name,      // symbol, length, bytes
+    op_function,  // name symbol
+    op_constant,  // id, double
+    op_variable,  // id, name symbol
+    op_copy,      // id, source id
+    op_binary,    // id, lhs id, operator, rhs id
+    op_unary,     // id, operand id
+    op_call,      // id, callee symbol, argument count, argument ids
+    op_if,        // id, condition id, then id, else id
+    op_for,       // id, variable symbol, start, cond, step, body ids
+  };
+
+  static constexpr char magic[4] = {'F', 'A', 'I', 'R'};
+  static constexpr std::uint8_t version = 1;
+
+  explicit IRWriter(const SymbolTable& symbols, int fd = STDOUT_FILENO)
+      : symbols(symbols), fd(fd) {
+    buf.reserve(bufferSize);
+  }
+  IRWriter(const IRWriter&) = delete;
+  IRWriter& operator=(const IRWriter&) = delete;
+  ~IRWriter() { flush(); }
+
+  // Only allowed before anything has been written.
+  void setFormat(Format f);
+  Format format() const { return fmt; }
+
+  void flush();
+
+  IRWriter& operator<<(std::string_view text) {
+    std::string& dst = fmt == Format::Text ? buf : pendingText;
+    dst.append(text);
+    if (dst.size() >= bufferSize) spill();
+    return *this;
+  }
+  IRWriter& operator<<(const char* text) {
+    return *this << std::string_view(text);
+  }
+  IRWriter& operator<<(const std::string& text) {
+    return *this << std::string_view(text);
+  }
+  IRWriter& operator<<(char c) { return *this << std::string_view(&c, 1); }
+  template <std::integral T>
+    requires(!std::same_as<T, bool> && !std::same_as<T, char>)
+  IRWriter& operator<<(T value) {
+    char tmp[24];
+    auto res = std::to_chars(tmp, tmp + sizeof(tmp), value);
+    return *this << std::string_view(tmp, res.ptr - tmp);
+  }
+  // Same digits as an ostream with the default precision (%g, 6).
+  IRWriter& operator<<(double value);
+
+  // One instruction each; see the class comment.
+  void function(Symbol name);
+  void constant(int id, double val);
+  void variable(int id, Symbol name);
+  void copy(int id, int src);
+  void binary(int id, int lhs, char op, int rhs);
+  void unary(int id, int operand);
+  void call(int id, Symbol callee, std::span<const int> args);
+  void ifExpr(int id, int cond, int then, int _else);
+  void forExpr(int id, Symbol var, int start, int cond, int step, int body);
+
+  // Bytes handed to write(2) so far.
+  std::size_t bytesWritten() const { return written; }
+  // Bytes of output so far, including what is still buffered.
+  std::size_t bytesOut() const {
+    return written + buf.size() + pendingText.size();
+  }
+
+ private:
+  static constexpr std::size_t bufferSize = 1 << 20;
+
+  void spill();
+  void beginRecord(IROp op);
+  void endRecord() {
+    if (buf.size() >= bufferSize) spill();
+  }
+  void putVarint(std::uint64_t v);
+  void putId(int id) { putVarint(static_cast<std::uint32_t>(id)); }
+  void putDouble(double v);
+  // Emits the Name record for `sym` unless it was already emitted; must not
+  // be called while a record is open.
+  void nameSymbol(Symbol sym);
+  void emitPendingText();
+
+  const SymbolTable& symbols;
+  int fd;
+  Format fmt = Format::Text;
+  std::string buf;
+  // Binary format only: text written since the last record.
+  std::string pendingText;
+  std::vector<bool> namedSymbols;
+  std::size_t written = 0;
+};
+
+// Replays a Binary stream into `out` (usually a Text writer), so tools can
+// turn it back into the textual IR. The names of the stream are interned
+// into `symbols`, which must be the table `out` was created with. Returns
+// false on a malformed stream.
+bool decodeBinaryIR(std::string_view data, SymbolTable& symbols,
+                    IRWriter& out);
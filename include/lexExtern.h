@@ -1,6 +1,13 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
 #include <map>
 #include <string>
-#include <fstream>
+#include <string_view>
+#include <vector>
+
+#include "symbols.h"
 
 enum Token
 {
@@ -28,11 +35,63 @@ struct SourceLocation
   int col;
 };
 
-extern double numVal;
-extern std::string identifierStr;
-extern char curTok;
-extern std::map<char, int> binOpPrecedence;
-extern SourceLocation curLoc;
-extern SourceLocation lexLoc;
-extern std::ifstream file;
-extern std::string fileName;
+// Whole input file, either mmapped or (for pipes and other unmappable inputs)
+// read in a single bulk read. The lexer walks `cur` up to `end`.
+struct SourceBuffer
+{
+  const char* begin = nullptr;
+  const char* end = nullptr;
+  const char* cur = nullptr;
+  std::size_t mappedSize = 0;  // non-zero when begin points into an mmap
+  std::string owned;           // storage for the bulk-read fallback
+};
+
+// One pre-lexed token. `payload` is the Symbol of a tok_identifier, the
+// constantPool index of a tok_number and unused otherwise. The location is
+// curLoc as the streaming lexer left it after producing the token.
+struct TokenEntry
+{
+  std::uint32_t payload;
+  std::uint32_t line;
+  std::uint32_t col : 24;
+  std::int32_t kind : 8;
+};
+static_assert(sizeof(TokenEntry) == 12, "TokenEntry should stay packed");
+
+// Lexer state for one input. getToken() streams tokens out of `source`;
+// lexAll() runs it to the end and leaves the whole input in `tokens`, the
+// form the parser consumes.
+class LexerContext
+{
+ public:
+  explicit LexerContext(SymbolTable& symbols) : symbols(symbols) {}
+  ~LexerContext() { closeSource(); }
+  LexerContext(const LexerContext&) = delete;
+  LexerContext& operator=(const LexerContext&) = delete;
+
+  bool openSource(const std::string& name);
+  void closeSource();
+  int advance();
+  int getToken();
+  void lexAll();
+
+  SourceBuffer source;
+  SourceLocation curLoc = {1, 0};
+  SourceLocation lexLoc = {1, 0};
+  double numVal = 0;
+  std::string_view identifierStr;  // slice of the source buffer
+  Symbol identifierSym = 0;        // interned identifierStr
+  std::string_view numStr;         // slice of the source buffer
+
+  std::vector<TokenEntry> tokens;  // whole input, ends in tok_eof
+  std::vector<double> constantPool;
+
+ private:
+  void skipComment();
+
+  SymbolTable& symbols;
+  // Position of the character most recently returned by advance(), used to
+  // slice identifiers and numbers out of the buffer without copying them.
+  const char* lastPos = nullptr;
+  char lastChar = ' ';  // one character of lookahead for getToken()
+};
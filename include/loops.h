@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "../include/dominators.h"
+#include "../include/ir.h"
+
+class AnalysisSession;
+
+// How many times the body of a for loop runs, when its start, step and
+// condition say so on their own.
+struct TripCount {
+  enum Kind : std::uint8_t {
+    Unknown,  // not a constant start and step with `i < N` or `N < i`
+    Exact,    // `count` times
+    Endless,  // the condition never becomes false
+  };
+  Kind kind = Unknown;
+  std::uint64_t count = 0;
+};
+
+// The natural loops of one function's IR blocks and how they nest.
+//
+// An edge t -> h is a back edge when h dominates t; the natural loop of
+// header h is h and every block that reaches one of its back edges without
+// going through h, and back edges to the same header make one loop. Loops
+// are found innermost first (headers in decreasing dominator-tree depth),
+// walking backwards from the latches; a walk that runs into an inner loop
+// that is already known jumps straight to its header, so every block is
+// visited about once per loop it is the header or latch of. Cycles with
+// more than one entry are not natural loops and are left out; the language
+// only produces for loops, which always have a single header.
+//
+// Loops are numbered outermost first, in the order of their headers in a
+// depth-first walk of the loop tree, so that the loops inside loop l are
+// [l + 1, end(l)) and contains() is two comparisons.
+class LoopForest {
+ public:
+  static constexpr std::uint32_t noLoop = ~std::uint32_t(0);
+
+  struct Loop {
+    std::uint32_t header;
+    std::uint32_t parent;  // noLoop for an outermost loop
+    std::uint32_t depth;   // 1 for an outermost loop
+    std::uint32_t end;     // one past the last loop nested in it
+    std::uint32_t numBlocks;  // its own and those of the loops inside it
+    std::vector<std::uint32_t> latches;  // sources of its back edges
+    std::vector<std::uint32_t> exits;    // blocks outside it entered from it
+    // For the loop of a ForExprAST: the constant trip count, if any.
+    TripCount trips;
+  };
+
+  LoopForest(const IRFunction& fn, const DominatorTree& dominators);
+
+  std::span<const Loop> loops() const { return all; }
+  // Innermost loop containing `block`, or noLoop.
+  std::uint32_t loopOf(std::uint32_t block) const { return innermost[block]; }
+  // Number of loops containing `block`.
+  std::uint32_t depth(std::uint32_t block) const {
+    return innermost[block] == noLoop ? 0 : all[innermost[block]].depth;
+  }
+  bool contains(std::uint32_t loop, std::uint32_t block) const {
+    std::uint32_t inner = innermost[block];
+    return inner != noLoop && loop <= inner && inner < all[loop].end;
+  }
+
+ private:
+  void findTripCounts(const IRFunction& fn);
+
+  std::vector<Loop> all;
+  std::vector<std::uint32_t> innermost;  // per block
+};
+
+// Prints the -o report to session.out: the loop-nesting forest of every
+// function, each loop with its header, latches, exits, size and trip
+// count.
+extern void printLoops(AnalysisSession& session);
@@ -2,9 +2,16 @@
 
 #include <iostream>
 #include <memory>
+#include <memory_resource>
 #include <string>
 #include <vector>
 
+#include "../include/arena.h"
+#include "../include/budget.h"
+#include "../include/callgraph.h"
+#include "../include/flowgraph.h"
+#include "../include/ir.h"
+#include "../include/irwriter.h"
 #include "../include/lexExtern.h"
 
 class ExprAST;
@@ -19,61 +26,227 @@ class FunctionAST;
 class IfExprAST;
 class ForExprAST;
 
-extern int justused;
-extern std::vector<ExprAST*> justBefore;
-extern std::map<std::string, int> varIds;
-extern std::map<std::string, ExprAST*> definedFunctions;
-extern int id;
-extern std::map<std::string, int> neededFunctions;
-extern std::multimap<ExprAST*, std::string> alreadyReturnedIfcont;
+
+class AnalysisSession;
+
+// Result of parsing the `def` at tokens[start] on its own.
+struct ParsedDefinition {
+  std::size_t start;
+  FunctionAST* fn = nullptr;  // nullptr when the definition failed to parse
+  std::size_t resume = 0;     // curTokIndex() after the parse
+  std::string errors;         // what logError() would have printed
+};
+
+// A node the traversal has handed out some but not all children of.
+struct TraversalFrame {
+  ExprAST* node;
+  std::uint32_t stage = 0;  // children handed out so far
+  // Where the node's entries on a session scratch stack begin.
+  std::uint32_t mark = 0;
+  int ids[3] = {};  // value ids of finished children, as the node needs them
+};
+
+// Parser over a lexed token buffer; expressions are parsed on explicit
+// stacks rather than by recursion (see parseExpression()). All of its state is
+// here, so several parsers may read the same tokens concurrently as long as
+// every name they intern is already in the symbol table.
+class Parser {
+ public:
+  Parser(const LexerContext& lexer, SymbolTable& symbols,
+         const std::map<char, int>& binOpPrecedence, Arena* arena)
+      : tokens(lexer.tokens),
+        constantPool(lexer.constantPool),
+        symbols(symbols),
+        binOpPrecedence(binOpPrecedence),
+        arena(arena) {}
+
+  int getNextToken();
+  // Token `ahead` positions after curTok (0 is the next one getNextToken()
+  // would load); stays on tok_eof past the end of the input.
+  const TokenEntry& peekToken(std::size_t ahead) const;
+  // Backtracks (or skips) so that tokens[pos] becomes curTok.
+  int seekToken(std::size_t pos);
+  // Index in `tokens` of curTok.
+  std::size_t curTokIndex() const;
+
+  ExprAST* parseExpression();
+  PrototypeAST* parseProtoype();
+  FunctionAST* parseDefinition();
+  PrototypeAST* parseExtern();
+  FunctionAST* parseTopLvlExpr();
+
+  char curTok = 0;
+  std::size_t tokPos = 0;  // index in `tokens` after curTok
+  double numVal = 0;
+  Symbol identifierSym = 0;
+  std::string_view identifierStr;
+  SourceLocation curLoc = {1, 0};
+  // When set, parse errors are collected here instead of going to stderr.
+  std::string* errorSink = nullptr;
+
+ private:
+  template <typename T, typename... Args>
+  T* newNode(SourceLocation loc, Args&&... args) {
+    return arena->make<T>(arena, loc, std::forward<Args>(args)...);
+  }
+  ExprAST* logError(const char* str);
+  PrototypeAST* logErrorP(const char* str);
+  int getTokPrecedence();
+
+  // A construct parseExpression() has started but whose sub-expressions are
+  // still being parsed.
+  struct ParseFrame {
+    enum Kind : unsigned char { Expr, Unary, Paren, Call, If, For, Var };
+    Kind kind;
+    unsigned char stage = 0;  // If, For, Var: which part comes next
+    int op = 0;               // Unary: the operator
+    SourceLocation loc = {};  // Call, If
+    Symbol name = 0;          // Call: callee; For: variable; Var: binding
+    // Expr: operands; Call: callArgs; Var: varBindings.
+    std::uint32_t base = 0;
+    std::uint32_t opBase = 0;  // Expr: binOps
+    ExprAST* parts[3] = {};    // If: cond, then; For: start, cond, step
+  };
+  struct PendingBinOp {
+    int prec;
+    char op;
+    SourceLocation loc;
+  };
+  // Value: a complete expression is ready for the innermost frame.
+  // Operand: a new operand has to be parsed. Fail: an error was reported.
+  enum class ParseStep { Value, Operand, Fail };
+
+  void openExpr();
+  void openParen();
+  ParseStep startPrimary(ExprAST*& value);
+  ParseStep finishFrame(ExprAST*& value);
+  ParseStep nextVarBinding();
+  ParseStep afterVarBinding();
+  void reduceBinOp();
+  ParseStep fail(const char* str);
+  void abandonParse();
+
+  // Explicit parse stacks, kept between calls to reuse their storage.
+  std::vector<ParseFrame> frames;
+  std::vector<ExprAST*> operands;
+  std::vector<PendingBinOp> binOps;
+  std::vector<ExprAST*> callArgs;
+  std::vector<std::pair<Symbol, ExprAST*>> varBindings;
+
+  const std::vector<TokenEntry>& tokens;
+  const std::vector<double>& constantPool;
+  SymbolTable& symbols;
+  const std::map<char, int>& binOpPrecedence;
+  Arena* arena;
+};
+
+// Everything needed to analyse one program: its source and tokens, the AST
+// (owned by astArena and, after a parallel parse, the worker arenas), the
+// traversal state threaded through the TraversalStep visitor (see
+// src/traversal.cpp) and the flow graph.
+// Sessions share no mutable state, so independent ones can run
+// concurrently; all output goes to `out`, which writes to `outFd`.
+class AnalysisSession {
+ public:
+  explicit AnalysisSession(int outFd = STDOUT_FILENO)
+      : out(symbols, outFd),
+        parser(lexer, symbols, binOpPrecedence, &astArena) {}
+  ~AnalysisSession() { releaseCompilationUnit(); }
+  AnalysisSession(const AnalysisSession&) = delete;
+  AnalysisSession& operator=(const AnalysisSession&) = delete;
+
+  // Opens and lexes `fileName`, then loads the first token.
+  bool open(const std::string& fileName);
+
+  bool genDefinition();
+  void traverseDefinition(FunctionAST* fn);
+  // Runs the traversal of `root` and everything below it.
+  void traverse(ExprAST* root);
+  // Writes parse errors to stderr after everything already written to
+  // `out`, so the two streams interleave in program order.
+  void reportErrors(const std::string& errors);
+  // Parses every top-level `def` of the token buffer on `threads` workers.
+  std::vector<ParsedDefinition> parseDefinitionsParallel(unsigned threads);
+
+  void printControlFlow();
+  // Summary-based report (-s): each reachable function once, with its call
+  // sites referring to the callees' summaries.
+  void printControlFlowSummary();
+  // Ball-Larus path counts of every function (-n), and the blocks of one
+  // numbered path for a "function:id" request (-d). A name defined more
+  // than once is its first definition, as for calls.
+  void printPathCounts();
+  void printPath(std::string_view request);
+  // Every numbered path of every function (-e), explored on `threads`
+  // workers.
+  void printAllPaths(unsigned threads);
+  // Random walks from main for a "walks[:seed]" request (-r), run on
+  // `threads` workers.
+  void printPathSamples(std::string_view request, unsigned threads);
+  // Dominator and post-dominator trees and frontiers of every function
+  // (-t).
+  void printDominators();
+  // Liveness, reaching definitions and def-use chains of every function
+  // (-u).
+  void printDataflow();
+  // Natural loops, their nesting and constant trip counts of every function
+  // (-o).
+  void printLoops();
+  void printFuncCat();
+  void printArenaUsage();
+  // Drops everything the compilation unit built.
+  void releaseCompilationUnit();
+
+  SymbolTable symbols;
+  IRWriter out;
+  LexerContext lexer{symbols};
+  std::map<char, int> binOpPrecedence;
+  Arena astArena;
+  std::vector<std::unique_ptr<Arena>> workerArenas;
+  Parser parser;
+  // Filled by traverseDefinition(); printed right away unless emitIR is off.
+  IRBuilder ir;
+  bool emitIR = true;
+
+  int justused = 0;
+  std::vector<ExprAST*> justBefore;
+  int id = 0;
+  SymbolMap<int> varIds;
+  SymbolMap<FunctionAST*> definedFunctions;
+  FlowGraph flowGraph;
+  CallGraph callGraph;
+  // Limits on the -c walk and the -e listing (-l).
+  Budgets budgets;
+
+  // Explicit traversal stack and the scratch stacks its frames point into.
+  std::vector<TraversalFrame> traversalStack;
+  std::vector<std::pair<Symbol, int>> savedVarIds;
+  std::vector<int> argIds;
+};
 
 class ExprAST {
  public:
   SourceLocation loc;
-  std::vector<ExprAST*> controlEdgesTo;
-  std::vector<ExprAST*> controlEdgesFrom;
-  std::string nodeName;
-  int controlTo;
+  std::pmr::vector<ExprAST*> controlEdgesTo;
+  std::pmr::vector<ExprAST*> controlEdgesFrom;
+  const char* nodeName = "";
+  NodeKind kind = NodeKind::Expr;
+  // Id of this node in the FlowGraph last built over it, if any.
+  NodeId graphNode = noNode;
+  // Function whose definition the node is part of; set by the traversal.
+  Symbol owner = 0;
   ExprAST* lastNode = this;
   ExprAST* startNode = this;
   bool isIfcont = false;
   bool isFuncEnd = false;
-  std::pair<std::string, FunctionAST*> funcDetails;
+  std::pair<Symbol, FunctionAST*> funcDetails;
 
  public:
-  ExprAST(SourceLocation loc = curLoc) : loc(loc) {
-    loc = curLoc;
-  }
-  virtual ~ExprAST() = default;
-  virtual int getLine() const { return loc.line; }
-  virtual int getCol() const { return loc.col; }
-  virtual void traverse() {}
-  virtual void showControl() {
-    std::cout << nodeName << " -> ";
-    if (controlEdgesTo.size() > 0)
-      controlTo = controlTo % controlEdgesTo.size();
-
-    bool foundReturn = false;
-
-    if(isFuncEnd && (controlEdgesTo.size() > 0)) {
-      if(controlEdgesTo[controlTo]->isIfcont) {
-        for(auto p : alreadyReturnedIfcont) {
-          if((p.second == funcDetails.first) && (p.first == controlEdgesTo[controlTo])) {
-            controlTo++;
-            foundReturn = true;
-            break;
-          } //if end
-        } //for end
-        if(!foundReturn) {
-          alreadyReturnedIfcont.insert(std::pair<ExprAST*, std::string>(controlEdgesTo[controlTo], funcDetails.first));
-        }
-      }
-    } //if end
-
-
-    if (controlTo < controlEdgesTo.size())
-      controlEdgesTo[controlTo++]->showControl();
-  }
+  // Edge and child vectors are allocated from `arena`, which owns the node.
+  ExprAST(Arena* arena, SourceLocation loc)
+      : loc(loc), controlEdgesTo(arena), controlEdgesFrom(arena) {}
+  int getLine() const { return loc.line; }
+  int getCol() const { return loc.col; }
 };
 
 class NumberExprAST : public ExprAST {
@@ -81,196 +254,38 @@ class NumberExprAST : public ExprAST {
   double val;
 
  public:
-  NumberExprAST(double val) : val(val) {
+  NumberExprAST(Arena* arena, SourceLocation loc, double val)
+      : ExprAST(arena, loc), val(val) {
     nodeName = "NumberExprAST";
-    controlTo = 0;
-    loc.line = curLoc.line;
-  }
-  void traverse() override {
-    for (auto jB : justBefore) {
-      controlEdgesFrom.push_back(jB);
-      jB->controlEdgesTo.push_back(this);
-    }
-    id++;
-    std::cout << "%" << id << " : (const number) " << val << std::endl;
-    justused = id;
-    justBefore.clear();
-    justBefore.push_back(this);
-    lastNode = this;
-    startNode = this;
+    kind = NodeKind::Number;
   }
-  void showControl() override {
-    std::cout << nodeName << " (" << val << ") -> ";
-    if (controlEdgesTo.size() > 0)
-      controlTo = controlTo % controlEdgesTo.size();
-    
-    bool foundReturn = false;
-
-    if(isFuncEnd && (controlEdgesTo.size() > 0)) {
-      if(controlEdgesTo[controlTo]->isIfcont) {
-        for(auto p : alreadyReturnedIfcont) {
-          if((p.second == funcDetails.first) && (p.first == controlEdgesTo[controlTo])) {
-            controlTo++;
-            foundReturn = true;
-            break;
-          } //if end
-        } //for end
-        if(!foundReturn) {
-          alreadyReturnedIfcont.insert(std::pair<ExprAST*, std::string>(controlEdgesTo[controlTo], funcDetails.first));
-        }
-      }
-    } //if end
-    if (controlTo < controlEdgesTo.size())
-      controlEdgesTo[controlTo++]->showControl();
-  } //showControl end
 };
 
 class VariableExprAST : public ExprAST {
  public:
-  std::string name;
+  Symbol name;
 
  public:
-  VariableExprAST(SourceLocation loc, const std::string& name)
-      : ExprAST(loc), name(name) {
+  VariableExprAST(Arena* arena, SourceLocation loc, Symbol name)
+      : ExprAST(arena, loc), name(name) {
     nodeName = "VariableExprAST";
-    controlTo = 0;
-    loc.line = curLoc.line;
-  }
-  void traverse() override {
-    int varId;
-    if (varIds.contains(name)) {
-      for (auto jB : justBefore) {
-        controlEdgesFrom.push_back(jB);
-        jB->controlEdgesTo.push_back(this);
-      }
-      varId = varIds[name];
-      justused = varId;
-      justBefore.clear();
-      justBefore.push_back(this);
-      // std::cout << "%" << varId << " : " << name << " (variable)" <<
-      // std::endl;
-      lastNode = this;
-      startNode = this;
-      return;
-    }
-    for (auto jB : justBefore) {
-      controlEdgesFrom.push_back(jB);
-      jB->controlEdgesTo.push_back(this);
-    }
-    std::cout << "Error: Variable undeclared. Proceeding by inserting a dummy "
-                 "declaration."
-              << std::endl;
-    id++;
-    varId = id;
-    justused = varId;
-    varIds.insert(std::pair<std::string, int>(name, varId));
-    std::cout << "%" << varId << " : " << name << " (variable)" << std::endl;
-    justBefore.clear();
-    justBefore.push_back(this);
-    lastNode = this;
-    startNode = this;
-  }
-  void showControl() override {
-    std::cout << nodeName << " (" << name << ") -> ";
-    if (controlEdgesTo.size() > 0)
-      controlTo = controlTo % controlEdgesTo.size();
-
-    bool foundReturn = false;
-
-    if(isFuncEnd && (controlEdgesTo.size() > 0)) {
-      if(controlEdgesTo[controlTo]->isIfcont) {
-        for(auto p : alreadyReturnedIfcont) {
-          if((p.second == funcDetails.first) && (p.first == controlEdgesTo[controlTo])) {
-            controlTo++;
-            foundReturn = true;
-            break;
-          } //if end
-        } //for end
-        if(!foundReturn) {
-          alreadyReturnedIfcont.insert(std::pair<ExprAST*, std::string>(controlEdgesTo[controlTo], funcDetails.first));
-        }
-      }
-    } //if end
-
-
-    if (controlTo < controlEdgesTo.size())
-      controlEdgesTo[controlTo++]->showControl();
+    kind = NodeKind::Variable;
   }
 };
 
 class VarExprAST : public ExprAST {
  public:
-  std::vector<std::pair<std::string, ExprAST*>> vars;
+  std::pmr::vector<std::pair<Symbol, ExprAST*>> vars;
   ExprAST* body;
 
  public:
-  VarExprAST(std::vector<std::pair<std::string, ExprAST*>> vars, ExprAST* body)
-      : vars(std::move(vars)), body(body) {
+  VarExprAST(Arena* arena, SourceLocation loc,
+             std::span<const std::pair<Symbol, ExprAST*>> vars, ExprAST* body)
+      : ExprAST(arena, loc),
+        vars(vars.begin(), vars.end(), arena),
+        body(body) {
     nodeName = "VarExprAST";
-    controlTo = 0;
-    loc.line = curLoc.line;
-  }
-  void traverse() override {
-    for (auto jB : justBefore) {
-      controlEdgesFrom.push_back(jB);
-      jB->controlEdgesTo.push_back(this);
-    }
-    justBefore.clear();
-    justBefore.push_back(this);
-    startNode = this;
-    std::cout << "Var Expression:" << std::endl;
-    std::vector<std::pair<std::string, int>> oldVarIds;
-    for (auto& var : vars) {
-      if (varIds.contains(var.first)) {
-        oldVarIds.push_back(
-            std::pair<std::string, int>(var.first, varIds[var.first]));
-        auto it = varIds.find(var.first);
-        varIds.erase(it);
-      }
-      var.second->traverse();
-      id++;
-      int varId = id;
-      std::cout << "%" << varId << " : " << var.first << " (variable)"
-                << std::endl;
-      std::cout << "%" << varId << " = %" << justused << std::endl;
-      varIds.insert(std::pair<std::string, int>(var.first, varId));
-    }
-    body->traverse();
-    for (auto& var : vars) {
-      auto it = varIds.find(var.first);
-      varIds.erase(it);
-    }
-    for (auto& var : oldVarIds) {
-      varIds.insert(std::pair<std::string, int>(var.first, var.second));
-    }
-    lastNode = body->lastNode;
-    std::cout << "end of Var Expression" << std::endl;
-  }
-  void showControl() override {
-    std::cout << nodeName << " -> ";
-    if (controlEdgesTo.size() > 0)
-      controlTo = controlTo % controlEdgesTo.size();
-
-    bool foundReturn = false;
-
-    if(isFuncEnd && (controlEdgesTo.size() > 0)) {
-      if(controlEdgesTo[controlTo]->isIfcont) {
-        for(auto p : alreadyReturnedIfcont) {
-          if((p.second == funcDetails.first) && (p.first == controlEdgesTo[controlTo])) {
-            controlTo++;
-            foundReturn = true;
-            break;
-          } //if end
-        } //for end
-        if(!foundReturn) {
-          alreadyReturnedIfcont.insert(std::pair<ExprAST*, std::string>(controlEdgesTo[controlTo], funcDetails.first));
-        }
-      }
-    } //if end
-
-    
-    if (controlTo < controlEdgesTo.size())
-      controlEdgesTo[controlTo++]->showControl();
+    kind = NodeKind::Var;
   }
 };
 
@@ -280,56 +295,11 @@ class BinaryExprAST : public ExprAST {
   ExprAST *LHS, *RHS;
 
  public:
-  BinaryExprAST(SourceLocation loc, char op, ExprAST* LHS, ExprAST* RHS)
-      : ExprAST(loc), op(op), LHS(LHS), RHS(RHS) {
+  BinaryExprAST(Arena* arena, SourceLocation loc, char op, ExprAST* LHS,
+                ExprAST* RHS)
+      : ExprAST(arena, loc), op(op), LHS(LHS), RHS(RHS) {
     nodeName = "BinaryExprAST";
-    controlTo = 0;
-    loc.line = curLoc.line;
-  }
-  void traverse() override {
-    //std::cout << "Binary Expression:" << std::endl;
-    LHS->traverse();
-    int lhs = justused;
-    RHS->traverse();
-    int rhs = justused;
-    id++;
-    std::cout << "%" << id << " = %" << lhs << " " << op << " %" << rhs
-              << std::endl;
-    justused = id;
-    for (auto jB : justBefore) {
-      controlEdgesFrom.push_back(jB);
-      jB->controlEdgesTo.push_back(this);
-    }
-    justBefore.clear();
-    justBefore.push_back(this);
-    startNode = LHS->startNode;
-    lastNode = this;
-  }
-  void showControl() override {
-    std::cout << nodeName << " (" << op << ") -> ";
-    if (controlEdgesTo.size() > 0)
-      controlTo = controlTo % controlEdgesTo.size();
-
-    bool foundReturn = false;
-
-    if(isFuncEnd && (controlEdgesTo.size() > 0)) {
-      if(controlEdgesTo[controlTo]->isIfcont) {
-        for(auto p : alreadyReturnedIfcont) {
-          if((p.second == funcDetails.first) && (p.first == controlEdgesTo[controlTo])) {
-            controlTo++;
-            foundReturn = true;
-            break;
-          } //if end
-        } //for end
-        if(!foundReturn) {
-          alreadyReturnedIfcont.insert(std::pair<ExprAST*, std::string>(controlEdgesTo[controlTo], funcDetails.first));
-        }
-      }
-    } //if end
-
-
-    if (controlTo < controlEdgesTo.size())
-      controlEdgesTo[controlTo++]->showControl();
+    kind = NodeKind::Binary;
   }
 };
 
@@ -339,128 +309,44 @@ class UnaryExprAST : public ExprAST {
   ExprAST* operand;
 
  public:
-  UnaryExprAST(char op, ExprAST* operand) : op(op), operand(operand) {
+  UnaryExprAST(Arena* arena, SourceLocation loc, char op, ExprAST* operand)
+      : ExprAST(arena, loc), op(op), operand(operand) {
     nodeName = "UnaryExprAST";
-    controlTo = 0;
-    loc.line = curLoc.line;
-  }
-  void traverse() override {
-    //std::cout << "Unary Expression:" << std::endl;
-    operand->traverse();
-    for (auto jB : justBefore) {
-      controlEdgesFrom.push_back(jB);
-      jB->controlEdgesTo.push_back(this);
-    }
-    justBefore.clear();
-    justBefore.push_back(this);
-    startNode = operand->startNode;
-    lastNode = this;
-    int op = justused;
-    id++;
-    std::cout << "%" << id << " = " << op << std::endl;
-    justused = id;
-  }
-  void showControl() override {
-    std::cout << nodeName << " (" << op << ") -> ";
-    if (controlEdgesTo.size() > 0)
-      controlTo = controlTo % controlEdgesTo.size();
-
-    bool foundReturn = false;
-
-    if(isFuncEnd && (controlEdgesTo.size() > 0)) {
-      if(controlEdgesTo[controlTo]->isIfcont) {
-        for(auto p : alreadyReturnedIfcont) {
-          if((p.second == funcDetails.first) && (p.first == controlEdgesTo[controlTo])) {
-            controlTo++;
-            foundReturn = true;
-            break;
-          } //if end
-        } //for end
-        if(!foundReturn) {
-          alreadyReturnedIfcont.insert(std::pair<ExprAST*, std::string>(controlEdgesTo[controlTo], funcDetails.first));
-        }
-      }
-    } //if end
-
-
-    if (controlTo < controlEdgesTo.size())
-      controlEdgesTo[controlTo++]->showControl();
+    kind = NodeKind::Unary;
   }
 };
 
 class PrototypeAST : public ExprAST {
  public:
-  std::string name;
-  std::vector<ExprAST*> args;
-  std::vector<std::string> argString;
+  Symbol name;
+  std::pmr::vector<ExprAST*> args;
+  std::pmr::vector<Symbol> argSymbols;
   bool isOperator;
   unsigned precedence;
   int line;
 
  public:
-  PrototypeAST(SourceLocation loc, const std::string& name,
-               std::vector<ExprAST*> args, std::vector<std::string> argString,
-               bool isOperator = false, unsigned precedence = 0)
-      : name(name),
-        args(std::move(args)),
-        argString(std::move(argString)),
+  PrototypeAST(Arena* arena, SourceLocation loc, Symbol name,
+               const std::vector<ExprAST*>& args,
+               const std::vector<Symbol>& argSymbols, bool isOperator = false,
+               unsigned precedence = 0)
+      : ExprAST(arena, loc),
+        name(name),
+        args(args.begin(), args.end(), arena),
+        argSymbols(argSymbols.begin(), argSymbols.end(), arena),
         isOperator(isOperator),
         precedence(precedence),
         line(loc.line) {
     nodeName = "PrototypeAST";
-    controlTo = 0;
-    loc.line = curLoc.line;
+    kind = NodeKind::Prototype;
+  }
+  const std::string& getName(const SymbolTable& symbols) const {
+    return symbols.name(name);
   }
-  const std::string getName() const { return name; }
   bool isUnaryOp() { return (isOperator && (args.size() == 1)); }
   bool isBinaryOp() { return (isOperator && (args.size() == 2)); }
-  char getOperatorName() { return name[name.size() - 1]; }
-  int getLine() const override { return line; }
-  void traverse() override {
-    for (auto jB : justBefore) {
-      controlEdgesFrom.push_back(jB);
-      jB->controlEdgesTo.push_back(this);
-    }
-    startNode = this;
-    //std::cout << "Prototype:" << std::endl;
-    //std::cout << "Function: " << name << std::endl;
-    //std::cout << "Arguments: ";
-    for (auto& arg : argString) {
-      id++;
-      int argId = id;
-      std::cout << "%" << argId << " : " << arg << " (variable)" << std::endl;
-      varIds.insert(std::pair<std::string, int>(arg, argId));
-    }
-    std::cout << std::endl;
-    justBefore.clear();
-    justBefore.push_back(this);
-    lastNode = this;
-  }
-  void showControl() override {
-    std::cout << nodeName << " (" << name << ") -> ";
-    if (controlEdgesTo.size() > 0)
-      controlTo = controlTo % controlEdgesTo.size();
-
-    bool foundReturn = false;
-
-    if(isFuncEnd && (controlEdgesTo.size() > 0)) {
-      if(controlEdgesTo[controlTo]->isIfcont) {
-        for(auto p : alreadyReturnedIfcont) {
-          if((p.second == funcDetails.first) && (p.first == controlEdgesTo[controlTo])) {
-            controlTo++;
-            foundReturn = true;
-            break;
-          } //if end
-        } //for end
-        if(!foundReturn) {
-          alreadyReturnedIfcont.insert(std::pair<ExprAST*, std::string>(controlEdgesTo[controlTo], funcDetails.first));
-        }
-      }
-    } //if end
-
-
-    if (controlTo < controlEdgesTo.size())
-      controlEdgesTo[controlTo++]->showControl();
+  char getOperatorName(const SymbolTable& symbols) {
+    return getName(symbols).back();
   }
 };
 
@@ -470,135 +356,27 @@ class FunctionAST : public ExprAST {
   ExprAST* body;
 
  public:
-  FunctionAST(PrototypeAST* proto, ExprAST* body) : proto(proto), body(body) {
+  FunctionAST(Arena* arena, SourceLocation loc, PrototypeAST* proto,
+              ExprAST* body)
+      : ExprAST(arena, loc), proto(proto), body(body) {
     nodeName = "FunctionAST";
-    controlTo = 0;
-    loc.line = curLoc.line;
-  }
-  void traverse() override {
-    std::cout << "Function: " << proto->name << std::endl;
-    justBefore.clear();
-    justBefore.push_back(this);
-    startNode = this;
-    proto->traverse();
-    body->traverse();
-    body->lastNode->isFuncEnd = true;
-    body->lastNode->funcDetails =
-        std::pair<std::string, FunctionAST*>(proto->name, this);
-    lastNode = body->lastNode;
-    justBefore.clear();
-  }
-  void showControl() override {
-    std::cout << nodeName << " (" << proto->name << ") -> ";
-    if (controlEdgesTo.size() > 0)
-      controlTo = controlTo % controlEdgesTo.size();
-
-    bool foundReturn = false;
-
-    if(isFuncEnd && (controlEdgesTo.size() > 0)) {
-      if(controlEdgesTo[controlTo]->isIfcont) {
-        for(auto p : alreadyReturnedIfcont) {
-          if((p.second == funcDetails.first) && (p.first == controlEdgesTo[controlTo])) {
-            controlTo++;
-            foundReturn = true;
-            break;
-          } //if end
-        } //for end
-        if(!foundReturn) {
-          alreadyReturnedIfcont.insert(std::pair<ExprAST*, std::string>(controlEdgesTo[controlTo], funcDetails.first));
-        }
-      }
-    } //if end
-
-
-    if(controlTo < controlEdgesTo.size())
-      controlEdgesTo[controlTo++]->showControl();
+    kind = NodeKind::Function;
   }
 };
 
 class CallExprAST : public ExprAST {
  public:
-  std::string callee;
-  std::vector<ExprAST*> args;
+  Symbol callee;
+  std::pmr::vector<ExprAST*> args;
 
  public:
-  CallExprAST(SourceLocation loc, const std::string& callee,
-              std::vector<ExprAST*> args)
-      : ExprAST(loc), callee(callee), args(std::move(args)) {
+  CallExprAST(Arena* arena, SourceLocation loc, Symbol callee,
+              std::span<ExprAST* const> args)
+      : ExprAST(arena, loc),
+        callee(callee),
+        args(args.begin(), args.end(), arena) {
     nodeName = "CallExprAST";
-    controlTo = 0;
-    loc.line = curLoc.line;
-  }
-  void traverse() override {
-    //std::cout << "Call Expression:" << std::endl;
-    std::vector<int> argIds;
-    lastNode = this;
-    for (auto& arg : args) {
-      arg->traverse();
-      argIds.push_back(justused);
-    }
-    if (args.size() > 0)
-      startNode = args[0]->startNode;
-    else
-      startNode = this;
-    for (auto jB : justBefore) {
-      controlEdgesFrom.push_back(jB);
-      jB->controlEdgesTo.push_back(this);
-    }
-    if (!definedFunctions.contains(callee)) {
-      std::cout << "Error: Function " << callee
-                << " not defined. Proceeding assuming a definition exists."
-                << std::endl;
-    } else {
-      ExprAST* expression = definedFunctions[callee];
-      FunctionAST* func = dynamic_cast<FunctionAST*>(expression);
-      controlEdgesTo.push_back(func->body->startNode);
-      func->body->startNode->controlEdgesFrom.push_back(this);
-      lastNode = func->body->lastNode;
-      // definedFunctions[callee]->lastNode->controlEdgesTo.push_back(this);
-      // controlEdgesFrom.push_back(definedFunctions[callee]->lastNode);
-    }
-    id++;
-    int callId = id;
-    std::cout << "%" << callId << " = call " << callee << "(";
-    if (argIds.size() > 0) {
-      std::cout << "%" << argIds[0];
-    }
-    for (int i = 1; i < argIds.size(); i++) {
-      std::cout << ", %" << argIds[i];
-    }
-    std::cout << ")" << std::endl;
-    justused = callId;
-    justBefore.clear();
-    justBefore.push_back(lastNode);
-  }
-  void showControl() override {
-    std::cout << nodeName << " (" << callee << ") -> ";
-    if (!neededFunctions.contains(callee))
-      neededFunctions.insert(std::pair<std::string, int>(callee, 0));
-    if (controlEdgesTo.size() > 0)
-      controlTo = controlTo % controlEdgesTo.size();
-
-    bool foundReturn = false;
-
-    if(isFuncEnd && (controlEdgesTo.size() > 0)) {
-      if(controlEdgesTo[controlTo]->isIfcont) {
-        for(auto p : alreadyReturnedIfcont) {
-          if((p.second == funcDetails.first) && (p.first == controlEdgesTo[controlTo])) {
-            controlTo++;
-            foundReturn = true;
-            break;
-          } //if end
-        } //for end
-        if(!foundReturn) {
-          alreadyReturnedIfcont.insert(std::pair<ExprAST*, std::string>(controlEdgesTo[controlTo], funcDetails.first));
-        }
-      }
-    } //if end
-
-
-    if (controlTo < controlEdgesTo.size())
-      controlEdgesTo[controlTo++]->showControl();
+    kind = NodeKind::Call;
   }
 };
 
@@ -607,179 +385,33 @@ class IfExprAST : public ExprAST {
   ExprAST *cond, *then, *_else, *ifcont;
 
  public:
-  IfExprAST(SourceLocation loc, ExprAST* cond, ExprAST* then, ExprAST* _else)
-      : ExprAST(loc), cond(cond), then(then), _else(_else) {
+  IfExprAST(Arena* arena, SourceLocation loc, ExprAST* cond, ExprAST* then,
+            ExprAST* _else)
+      : ExprAST(arena, loc), cond(cond), then(then), _else(_else) {
     nodeName = "IfExprAST";
-    controlTo = 0;
-    ifcont = new ExprAST(loc);
+    kind = NodeKind::If;
+    ifcont = arena->make<ExprAST>(arena, loc);
     ifcont->nodeName = "IfCont";
-    ifcont->controlTo = 0;
+    ifcont->kind = NodeKind::IfCont;
     ifcont->isIfcont = true;
-    loc.line = curLoc.line;
-  }
-  void traverse() override {
-    //std::cout << "If Expression:" << std::endl;
-    for (auto jB : justBefore) {
-      controlEdgesFrom.push_back(jB);
-      jB->controlEdgesTo.push_back(this);
-    }
-    justBefore.clear();
-    justBefore.push_back(this);
-    startNode = this;
-    cond->traverse();
-    int condId = justused;
-    then->traverse();
-    int thenId = justused;
-    _else->traverse();
-    /*_else->controlEdgesFrom[_else->controlEdgesFrom.size() - 1]
-        ->controlEdgesTo.pop_back();
-    _else->controlEdgesFrom.pop_back();*/
-    int elseId = justused;
-    for (int i = then->lastNode->controlEdgesTo.size() - 1; i > -1; i--) {
-      if (then->lastNode->controlEdgesTo[i] == _else->startNode) {
-        then->lastNode->controlEdgesTo.erase(
-            then->lastNode->controlEdgesTo.begin() + i);
-        for (int j = _else->startNode->controlEdgesFrom.size() - 1; j > -1;
-             j--) {
-          if (_else->startNode->controlEdgesFrom[j] == then->lastNode) {
-            _else->startNode->controlEdgesFrom.erase(
-                _else->startNode->controlEdgesFrom.begin() + j);
-            break;
-          }
-        }
-        break;
-      }
-    }
-    cond->lastNode->controlEdgesTo.push_back(_else->startNode);
-    _else->startNode->controlEdgesFrom.push_back(cond->lastNode);
-    then->lastNode->controlEdgesTo.push_back(ifcont);
-    ifcont->controlEdgesFrom.push_back(then->lastNode);
-    _else->lastNode->controlEdgesTo.push_back(ifcont);
-    ifcont->controlEdgesFrom.push_back(_else->lastNode);
-    id++;
-    int ifId = id;
-    std::cout << "%" << ifId << " = if %" << condId << " then %" << thenId
-              << " else %" << elseId << std::endl;
-    justused = ifId;
-    justBefore.clear();
-    // For lastnode, might need a node where then and else meet after control
-    // end
-    lastNode = ifcont;
-    justBefore.push_back(ifcont);
-  }
-  void showControl() override {
-    std::cout << nodeName << std::endl;
-    std::cout << "\nCondition (line: " << cond->startNode->loc.line << ") True:\n-> ";
-    if (controlEdgesTo.size() > 0)
-      controlTo = controlTo % controlEdgesTo.size();
-
-    bool foundReturn = false;
-
-    if(isFuncEnd && (controlEdgesTo.size() > 0)) {
-      if(controlEdgesTo[controlTo]->isIfcont) {
-        for(auto p : alreadyReturnedIfcont) {
-          if((p.second == funcDetails.first) && (p.first == controlEdgesTo[controlTo])) {
-            controlTo++;
-            foundReturn = true;
-            break;
-          } //if end
-        } //for end
-        if(!foundReturn) {
-          alreadyReturnedIfcont.insert(std::pair<ExprAST*, std::string>(controlEdgesTo[controlTo], funcDetails.first));
-        }
-      }
-    } //if end
-
-
-    if (controlTo < controlEdgesTo.size())
-      controlEdgesTo[controlTo++]->showControl();
-    std::cout << " (program exit)";
-    std::cout << "\n\nCondition (line: " << cond->startNode->loc.line << ") False:\n-> ";
-    if (controlEdgesTo.size() > 0)
-      controlTo = controlTo % controlEdgesTo.size();
-
-    foundReturn = false;
-
-    if(isFuncEnd && (controlEdgesTo.size() > 0)) {
-      if(controlEdgesTo[controlTo]->isIfcont) {
-        for(auto p : alreadyReturnedIfcont) {
-          if((p.second == funcDetails.first) && (p.first == controlEdgesTo[controlTo])) {
-            controlTo++;
-            foundReturn = true;
-            break;
-          } //if end
-        } //for end
-        if(!foundReturn) {
-          alreadyReturnedIfcont.insert(std::pair<ExprAST*, std::string>(controlEdgesTo[controlTo], funcDetails.first));
-        }
-      }
-    } //if end
-
-
-    if (controlTo < controlEdgesTo.size())
-      controlEdgesTo[controlTo++]->showControl();
   }
 };
 
 class ForExprAST : public ExprAST {
  public:
-  std::string varName;
+  Symbol varName;
   ExprAST *start, *cond, *step, *body;
 
  public:
-  ForExprAST(const std::string& varName, ExprAST* start, ExprAST* cond,
-             ExprAST* step, ExprAST* body)
-      : varName(varName), start(start), cond(cond), step(step), body(body) {
+  ForExprAST(Arena* arena, SourceLocation loc, Symbol varName,
+             ExprAST* start, ExprAST* cond, ExprAST* step, ExprAST* body)
+      : ExprAST(arena, loc),
+        varName(varName),
+        start(start),
+        cond(cond),
+        step(step),
+        body(body) {
     nodeName = "ForExprAST";
-    controlTo = 0;
-    loc.line = curLoc.line;
-  }
-  void traverse() override {
-    //std::cout << "For Expression:" << std::endl;
-    start->traverse();
-    int startId = justused;
-    cond->traverse();
-    int condId = justused;
-    body->traverse();
-    int bodyId = justused;
-    step->traverse();
-    int stepId = justused;
-    step->controlEdgesTo.push_back(cond->startNode);
-    cond->controlEdgesFrom.push_back(&(*step));
-    id++;
-    int forId = id;
-    std::cout << "%" << forId << " = for " << varName << " = %" << startId
-              << " to %" << condId << " step %" << stepId << " do %" << bodyId
-              << std::endl;
-    justused = forId;
-    justBefore.clear();
-    justBefore.push_back(cond->lastNode);
-    lastNode = cond->lastNode;
-  }
-  void showControl() override {
-    std::cout << nodeName << " -> " << std::endl;
-    if (controlEdgesTo.size() > 0)
-      controlTo = controlTo % controlEdgesTo.size();
-
-    bool foundReturn = false;
-
-    if(isFuncEnd && (controlEdgesTo.size() > 0)) {
-      if(controlEdgesTo[controlTo]->isIfcont) {
-        for(auto p : alreadyReturnedIfcont) {
-          if((p.second == funcDetails.first) && (p.first == controlEdgesTo[controlTo])) {
-            controlTo++;
-            foundReturn = true;
-            break;
-          } //if end
-        } //for end
-        if(!foundReturn) {
-          alreadyReturnedIfcont.insert(std::pair<ExprAST*, std::string>(controlEdgesTo[controlTo], funcDetails.first));
-        }
-      }
-    } //if end
-
-
-    if (controlTo < controlEdgesTo.size())
-      controlEdgesTo[controlTo++]->showControl();
+    kind = NodeKind::For;
   }
 };
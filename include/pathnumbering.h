@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "../include/bigint.h"
+#include "../include/ir.h"
+
+// Ball-Larus numbering of the paths through one function's IR blocks.
+//
+// Loop back edges (step block to loop header) are cut, and each is replaced
+// by two dummy edges: entry -> header, for paths that start a new iteration,
+// and step -> exit, for paths that end by taking the back edge. What is left
+// is a DAG, whose entry-to-exit paths are numbered 0 .. count() - 1: every
+// edge carries an increment, and the sum of the increments along a path is
+// its id. Counting and numbering are linear in the number of blocks and
+// edges; counts are exact, however many ifs are chained.
+class PathNumbering {
+ public:
+  struct Edge {
+    enum Kind : std::uint8_t {
+      Real,
+      FromEntry,  // dummy: the path starts at loop header `to`
+      ToExit,     // dummy: the path ends with the back edge to `header`
+    };
+    std::uint32_t from;
+    std::uint32_t to;
+    Kind kind;
+    std::uint32_t header;  // ToExit only
+    BigUint increment;
+  };
+
+  explicit PathNumbering(const IRFunction& fn);
+
+  const BigUint& count() const { return numPaths[0]; }
+  // Paths from `block` to the exit.
+  const BigUint& pathsFrom(std::uint32_t block) const {
+    return numPaths[block];
+  }
+  std::uint32_t exitBlock() const { return exit; }
+  // DAG edges leaving `block`, in increasing order of increment.
+  std::span<const Edge> edgesFrom(std::uint32_t block) const {
+    return {edges.data() + offsets[block], offsets[block + 1] - offsets[block]};
+  }
+
+  // The edges of path `id`, from the entry to the exit; false if `id` is
+  // not less than count().
+  bool decode(BigUint id, std::vector<const Edge*>& path) const;
+
+  // Appends `path` as "B0 -> B2 -> return", starting with
+  // "(next iteration) Bh" or ending with " -> (back edge to Bh)" where it
+  // takes a dummy edge.
+  static void describe(std::span<const Edge* const> path, std::string& text);
+
+ private:
+  std::uint32_t exit = 0;
+  std::vector<std::uint32_t> offsets;  // CSR over blocks
+  std::vector<Edge> edges;
+  std::vector<BigUint> numPaths;  // paths from each block to the exit
+};
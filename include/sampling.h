@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+
+#include "../include/symbols.h"
+
+class AnalysisSession;
+
+// Prints the -r report to session.out: `walks` random walks from the entry
+// of `entry` to its return, with estimates of the walk length, of how often
+// each callee is called and of how often each block is reached, each with
+// a 95% confidence interval.
+//
+// A walk runs over the IR blocks of the function summaries (see
+// summary.h), taking a successor uniformly at random at each branch and
+// stepping into every defined callee and back out to the call site, so
+// calls always return to where they were made. Walk i draws its choices
+// from its own generator seeded with (seed, i), and the walks are shared
+// out among `threads` workers in batches, so the report depends only on
+// `walks` and `seed`.
+extern void printPathSamples(AnalysisSession& session, Symbol entry,
+                             std::uint64_t walks, std::uint64_t seed,
+                             unsigned threads);
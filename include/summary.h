@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <span>
+#include <vector>
+
+#include "../include/ir.h"
+#include "../include/symbols.h"
+
+class AnalysisSession;
+
+struct CallSite {
+  std::uint32_t block;  // block of the call instruction
+  Symbol callee;
+  bool defined;  // the callee had a definition when the call was built
+};
+
+// Control flow of one function on its own, taken from its IR once: the
+// block graph, the number of acyclic entry-to-exit paths and the call
+// sites. Interprocedural walks go from a call site to the callee's summary
+// instead of through the callee's body, so a function is analysed once no
+// matter how often it is called.
+struct FunctionSummary {
+  Symbol name = 0;
+  std::uint32_t numBlocks = 0;
+  std::uint32_t exitBlock = 0;  // the block that returns; block 0 is entry
+  std::uint32_t numInsts = 0;
+  // Paths from entry to exit that take no loop back edge; saturates at
+  // UINT64_MAX.
+  std::uint64_t paths = 0;
+  std::vector<CallSite> calls;  // in instruction order
+
+  std::span<const std::uint32_t> succs(std::uint32_t block) const {
+    return {succList.data() + succOffsets[block],
+            succOffsets[block + 1] - succOffsets[block]};
+  }
+
+  std::vector<std::uint32_t> succOffsets;  // numBlocks + 1 entries
+  std::vector<std::uint32_t> succList;
+};
+
+// Summaries of the functions of a session, each built the first time it is
+// asked for. A name defined more than once refers to its first definition,
+// as calls do.
+class SummaryTable {
+ public:
+  explicit SummaryTable(const std::vector<IRFunction>& functions);
+
+  // nullptr when `fn` has no definition. The pointer stays valid for the
+  // lifetime of the table.
+  const FunctionSummary* get(Symbol fn);
+  std::size_t built() const { return summaries.size(); }
+
+ private:
+  const std::vector<IRFunction>& functions;
+  SymbolMap<std::uint32_t> irIndex;
+  SymbolMap<const FunctionSummary*> cache;
+  std::deque<FunctionSummary> summaries;
+};
+
+// Prints the -s report to session.out: the summary of `entry` and of every
+// function it reaches through calls, each once, in the order they are first
+// reached.
+extern void printControlFlowSummaries(AnalysisSession& session, Symbol entry);
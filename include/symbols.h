@@ -0,0 +1,88 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Dense 32-bit identifier handed out by the interner. Two identifiers have
+// the same Symbol exactly when their spelling is the same.
+using Symbol = std::uint32_t;
+
+class SymbolTable {
+ public:
+  Symbol intern(std::string_view text) {
+    auto it = ids.find(text);
+    if (it != ids.end()) return it->second;
+    Symbol sym = static_cast<Symbol>(names.size());
+    // std::deque never relocates its elements, so the view used as the key
+    // stays valid for the lifetime of the table.
+    const std::string& stored = names.emplace_back(text);
+    ids.emplace(std::string_view(stored), sym);
+    return sym;
+  }
+  const std::string& name(Symbol sym) const { return names[sym]; }
+  std::size_t size() const { return names.size(); }
+
+ private:
+  std::deque<std::string> names;
+  std::unordered_map<std::string_view, Symbol> ids;
+};
+
+// Symbol-indexed table replacing the std::map<std::string, T> lookups. Every
+// operation is O(1); clear() only touches the entries that were set.
+template <typename T>
+class SymbolMap {
+ public:
+  bool contains(Symbol sym) const {
+    return sym < present.size() && present[sym];
+  }
+  // Only valid when contains(sym).
+  const T& at(Symbol sym) const { return values[sym]; }
+  T& operator[](Symbol sym) {
+    if (sym >= present.size()) {
+      present.resize(sym + 1, false);
+      values.resize(sym + 1);
+    }
+    if (!present[sym]) {
+      present[sym] = true;
+      touched.push_back(sym);
+    }
+    return values[sym];
+  }
+  // Like std::map::insert, an existing entry is left untouched.
+  void insert(Symbol sym, const T& value) {
+    if (!contains(sym)) (*this)[sym] = value;
+  }
+  void erase(Symbol sym) {
+    if (contains(sym)) {
+      present[sym] = false;
+      values[sym] = T();
+    }
+  }
+  void clear() {
+    for (Symbol sym : touched) {
+      present[sym] = false;
+      values[sym] = T();
+    }
+    touched.clear();
+  }
+  // Symbols currently present, in ascending Symbol order.
+  std::vector<Symbol> keys() const {
+    std::vector<Symbol> result;
+    for (Symbol sym : touched) {
+      if (present[sym]) result.push_back(sym);
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+  }
+
+ private:
+  std::vector<bool> present;
+  std::vector<T> values;
+  std::vector<Symbol> touched;
+};
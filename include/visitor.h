@@ -0,0 +1,53 @@
+#pragma once
+
+#include <utility>
+
+#include "../include/parser.h"
+
+// Static dispatch over the AST. The node classes have no virtual methods;
+// a pass is a visitor object with an operator() for each node type it cares
+// about (plus one taking ExprAST& or a template for the rest), and
+// visitNode() picks the overload with a switch on the node's kind tag. New
+// passes therefore plug in without touching the node classes, and every
+// call is direct, so the compiler can inline the pass into the switch.
+//
+// Expr and IfCont nodes are plain ExprAST objects and are visited as such.
+template <typename Visitor, typename... Args>
+decltype(auto) visitNode(ExprAST& node, Visitor&& visitor, Args&&... args) {
+  switch (node.kind) {
+    case NodeKind::Number:
+      return visitor(static_cast<NumberExprAST&>(node),
+                     std::forward<Args>(args)...);
+    case NodeKind::Variable:
+      return visitor(static_cast<VariableExprAST&>(node),
+                     std::forward<Args>(args)...);
+    case NodeKind::Var:
+      return visitor(static_cast<VarExprAST&>(node),
+                     std::forward<Args>(args)...);
+    case NodeKind::Binary:
+      return visitor(static_cast<BinaryExprAST&>(node),
+                     std::forward<Args>(args)...);
+    case NodeKind::Unary:
+      return visitor(static_cast<UnaryExprAST&>(node),
+                     std::forward<Args>(args)...);
+    case NodeKind::Prototype:
+      return visitor(static_cast<PrototypeAST&>(node),
+                     std::forward<Args>(args)...);
+    case NodeKind::Function:
+      return visitor(static_cast<FunctionAST&>(node),
+                     std::forward<Args>(args)...);
+    case NodeKind::Call:
+      return visitor(static_cast<CallExprAST&>(node),
+                     std::forward<Args>(args)...);
+    case NodeKind::If:
+      return visitor(static_cast<IfExprAST&>(node),
+                     std::forward<Args>(args)...);
+    case NodeKind::For:
+      return visitor(static_cast<ForExprAST&>(node),
+                     std::forward<Args>(args)...);
+    case NodeKind::Expr:
+    case NodeKind::IfCont:
+      break;
+  }
+  return visitor(node, std::forward<Args>(args)...);
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing task pool. Every worker owns a deque: it pushes and pops
+// its own tasks at the back (depth first, so its working set stays small)
+// and, when that runs dry, steals from the front of the others' deques,
+// where the oldest and usually largest tasks are.
+//
+// run() returns once every task, including those pushed while running, has
+// been processed. Tasks run in no particular order; callers that need a
+// deterministic result key their output by something other than timing.
+template <typename Task>
+class WorkStealingPool {
+ public:
+  explicit WorkStealingPool(unsigned threads)
+      : queues(threads ? threads : 1) {
+    for (auto& q : queues) q = std::make_unique<Queue>();
+  }
+
+  unsigned workers() const { return static_cast<unsigned>(queues.size()); }
+
+  // Adds a task to `worker`'s deque; callable from inside process().
+  void push(unsigned worker, Task task) {
+    pending.fetch_add(1, std::memory_order_relaxed);
+    Queue& q = *queues[worker];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    q.tasks.push_back(std::move(task));
+  }
+
+  // Calls process(worker, task) for every task. The initial tasks are dealt
+  // round-robin; worker 0 runs on the calling thread.
+  template <typename Process>
+  void run(std::vector<Task> initial, Process process) {
+    for (std::size_t i = 0; i < initial.size(); i++) {
+      push(static_cast<unsigned>(i % workers()), std::move(initial[i]));
+    }
+    std::vector<std::thread> threads;
+    for (unsigned w = 1; w < workers(); w++) {
+      threads.emplace_back([this, w, &process] { work(w, process); });
+    }
+    work(0, process);
+    for (auto& t : threads) t.join();
+  }
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  bool popOwn(unsigned worker, Task& task) {
+    Queue& q = *queues[worker];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.tasks.empty()) return false;
+    task = std::move(q.tasks.back());
+    q.tasks.pop_back();
+    return true;
+  }
+
+  bool steal(unsigned thief, Task& task) {
+    for (unsigned i = 1; i < workers(); i++) {
+      Queue& q = *queues[(thief + i) % workers()];
+      std::lock_guard<std::mutex> lock(q.mutex);
+      if (q.tasks.empty()) continue;
+      task = std::move(q.tasks.front());
+      q.tasks.pop_front();
+      return true;
+    }
+    return false;
+  }
+
+  template <typename Process>
+  void work(unsigned worker, Process& process) {
+    Task task;
+    while (true) {
+      if (popOwn(worker, task) || steal(worker, task)) {
+        process(worker, task);
+        pending.fetch_sub(1, std::memory_order_acq_rel);
+      } else if (pending.load(std::memory_order_acquire) == 0) {
+        return;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  std::vector<std::unique_ptr<Queue>> queues;
+  // Tasks pushed but not yet finished; a task's children are pushed before
+  // it finishes, so this only reaches zero when all the work is done.
+  std::atomic<std::size_t> pending{0};
+};
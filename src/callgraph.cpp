@@ -0,0 +1,130 @@
+#include "../include/callgraph.h"
+
+#include <algorithm>
+
+void CallGraph::clear() {
+  names.clear();
+  ids.clear();
+  calleeOffsets.clear();
+  calleeList.clear();
+  components.clear();
+  componentOffsets.assign(1, 0);
+  memberList.clear();
+}
+
+void CallGraph::build(const std::vector<IRFunction>& functions) {
+  clear();
+
+  // Later definitions of a name are ignored, as in definedFunctions.
+  std::vector<std::uint32_t> defs;
+  for (std::uint32_t i = 0; i < functions.size(); i++) {
+    Symbol name = functions[i].name;
+    if (!ids.contains(name)) {
+      ids.insert(name, static_cast<FunctionId>(names.size()));
+      names.push_back(name);
+      defs.push_back(i);
+    }
+  }
+
+  // lastCaller[g] == f + 1 once f's call to g is recorded.
+  std::vector<FunctionId> lastCaller(names.size(), 0);
+  calleeOffsets.reserve(names.size() + 1);
+  for (FunctionId f = 0; f < names.size(); f++) {
+    calleeOffsets.push_back(static_cast<std::uint32_t>(calleeList.size()));
+    for (const IRInstruction& inst : functions[defs[f]].insts) {
+      if (inst.op != IROpcode::Call || !ids.contains(inst.sym)) continue;
+      FunctionId g = ids.at(inst.sym);
+      if (lastCaller[g] != f + 1) {
+        lastCaller[g] = f + 1;
+        calleeList.push_back(g);
+      }
+    }
+  }
+  calleeOffsets.push_back(static_cast<std::uint32_t>(calleeList.size()));
+
+  findComponents();
+}
+
+// Tarjan's algorithm with an explicit stack, since call chains can be as
+// deep as the program is long.
+void CallGraph::findComponents() {
+  constexpr std::uint32_t unvisited = ~std::uint32_t(0);
+  std::size_t n = names.size();
+  std::vector<std::uint32_t> index(n, unvisited);
+  std::vector<std::uint32_t> low(n);
+  std::vector<bool> onStack(n, false);
+  std::vector<FunctionId> stack;
+  struct Frame {
+    FunctionId f;
+    std::uint32_t next;  // callees(f)[next] is the next edge to follow
+  };
+  std::vector<Frame> frames;
+  std::uint32_t counter = 0;
+
+  components.assign(n, 0);
+  for (FunctionId root = 0; root < n; root++) {
+    if (index[root] != unvisited) continue;
+    frames.push_back(Frame{root, 0});
+    index[root] = low[root] = counter++;
+    stack.push_back(root);
+    onStack[root] = true;
+
+    while (!frames.empty()) {
+      Frame& frame = frames.back();
+      FunctionId f = frame.f;
+      std::span<const FunctionId> out = callees(f);
+      if (frame.next < out.size()) {
+        FunctionId g = out[frame.next++];
+        if (index[g] == unvisited) {
+          index[g] = low[g] = counter++;
+          stack.push_back(g);
+          onStack[g] = true;
+          frames.push_back(Frame{g, 0});
+        } else if (onStack[g]) {
+          low[f] = std::min(low[f], index[g]);
+        }
+        continue;
+      }
+
+      frames.pop_back();
+      if (!frames.empty()) {
+        FunctionId parent = frames.back().f;
+        low[parent] = std::min(low[parent], low[f]);
+      }
+      if (low[f] != index[f]) continue;
+
+      auto c = static_cast<std::uint32_t>(componentOffsets.size() - 1);
+      FunctionId member;
+      do {
+        member = stack.back();
+        stack.pop_back();
+        onStack[member] = false;
+        components[member] = c;
+        memberList.push_back(member);
+      } while (member != f);
+      componentOffsets.push_back(static_cast<std::uint32_t>(memberList.size()));
+    }
+  }
+}
+
+DenseBitset CallGraph::reachableFrom(FunctionId root) const {
+  DenseBitset reached(size());
+  DenseBitset seen(componentCount());
+  std::vector<std::uint32_t> work{componentOf(root)};
+  seen.set(work.back());
+  while (!work.empty()) {
+    std::uint32_t c = work.back();
+    work.pop_back();
+    for (FunctionId f : members(c)) {
+      reached.set(f);
+      for (FunctionId g : callees(f)) {
+        std::uint32_t d = componentOf(g);
+        if (!seen.test(d)) {
+          seen.set(d);
+          work.push_back(d);
+        }
+      }
+    }
+  }
+  return reached;
+}
@@ -0,0 +1,450 @@
+#include "../include/dataflow.h"
+
+#include <algorithm>
+#include <string>
+
+#include "../include/parser.h"
+
+namespace {
+
+constexpr std::uint32_t noPosition = ~std::uint32_t(0);
+
+// The blocks reachable from `root` along `next`, in reverse postorder.
+template <typename Next>
+std::vector<std::uint32_t> reversePostorder(std::size_t numBlocks,
+                                            std::uint32_t root, Next next) {
+  std::vector<std::uint32_t> order;
+  std::vector<bool> seen(numBlocks, false);
+  struct Frame {
+    std::uint32_t block;
+    std::uint32_t edge;  // index into next(block)
+  };
+  std::vector<Frame> stack{Frame{root, 0}};
+  seen[root] = true;
+  while (!stack.empty()) {
+    Frame& frame = stack.back();
+    const std::vector<std::uint32_t>& succs = next(frame.block);
+    if (frame.edge == succs.size()) {
+      order.push_back(frame.block);
+      stack.pop_back();
+      continue;
+    }
+    std::uint32_t succ = succs[frame.edge++];
+    if (seen[succ]) continue;
+    seen[succ] = true;
+    stack.push_back(Frame{succ, 0});
+  }
+  return {order.rbegin(), order.rend()};
+}
+
+std::uint32_t returningBlock(const IRFunction& fn) {
+  std::uint32_t exit = 0;
+  for (std::uint32_t b = 0; b < fn.blocks.size(); b++) {
+    if (fn.blocks[b].term == IRTerminator::Ret) exit = b;
+  }
+  return exit;
+}
+
+}  // namespace
+
+BitSolution solveBitProblem(const IRFunction& fn, const BitProblem& problem) {
+  std::size_t numBlocks = fn.blocks.size();
+  bool forward = problem.direction == BitProblem::Forward;
+  auto next = [&](std::uint32_t b) -> const std::vector<std::uint32_t>& {
+    return forward ? fn.blocks[b].succs : fn.blocks[b].preds;
+  };
+  auto prev = [&](std::uint32_t b) -> const std::vector<std::uint32_t>& {
+    return forward ? fn.blocks[b].preds : fn.blocks[b].succs;
+  };
+  std::uint32_t root = forward ? 0 : returningBlock(fn);
+  std::vector<std::uint32_t> order = reversePostorder(numBlocks, root, next);
+  std::vector<std::uint32_t> position(numBlocks, noPosition);
+  for (std::uint32_t i = 0; i < order.size(); i++) {
+    position[order[i]] = i;
+  }
+
+  BitSolution solution;
+  solution.in.assign(numBlocks, DenseBitset(problem.bits));
+  solution.out.assign(numBlocks, DenseBitset(problem.bits));
+  // What the meet computes and what the transfer function computes.
+  std::vector<DenseBitset>& joined = forward ? solution.in : solution.out;
+  std::vector<DenseBitset>& flowed = forward ? solution.out : solution.in;
+  bool intersect = problem.meet == BitProblem::Intersection;
+  if (intersect) {
+    // Everything, until an incoming edge says otherwise.
+    for (std::uint32_t b : order) {
+      flowed[b].setAll();
+    }
+  }
+
+  DenseBitset pending(order.size());
+  pending.setAll();
+  for (std::size_t first = pending.findNext(0); first < order.size();
+       first = pending.findNext(0)) {
+    solution.passes++;
+    for (std::size_t i = first; i < order.size(); i = pending.findNext(i + 1)) {
+      pending.reset(i);
+      std::uint32_t b = order[i];
+      DenseBitset& facts = joined[b];
+      bool any = b == root;
+      if (any) facts = problem.boundary;
+      for (std::uint32_t p : prev(b)) {
+        if (position[p] == noPosition) continue;
+        if (!any) {
+          facts = flowed[p];
+          any = true;
+        } else if (intersect) {
+          facts.intersectWith(flowed[p]);
+        } else {
+          facts.unionWith(flowed[p]);
+        }
+      }
+      solution.visits++;
+      if (flowed[b].assignTransfer(facts, problem.gen[b], problem.kill[b])) {
+        for (std::uint32_t s : next(b)) {
+          pending.set(position[s]);
+        }
+      }
+    }
+  }
+  return solution;
+}
+
+FunctionVariables::FunctionVariables(const IRFunction& fn) {
+  // Variable of each value id, or noInst.
+  std::vector<std::uint32_t> varOf(fn.valueInsts.size(), noInst);
+  for (std::uint32_t i = 0; i < fn.insts.size(); i++) {
+    const IRInstruction& inst = fn.insts[i];
+    if (inst.op == IROpcode::Param || inst.op == IROpcode::Undeclared ||
+        inst.op == IROpcode::Bind) {
+      varOf[inst.id - fn.firstId] = static_cast<std::uint32_t>(size());
+      bindings.push_back(i);
+    }
+  }
+  auto variable = [&](const IROperand& op) {
+    std::uint32_t index = op.index - static_cast<std::uint32_t>(fn.firstId);
+    return op.kind == IROperand::Value && index < varOf.size() ? varOf[index]
+                                                                : noInst;
+  };
+  auto def = [&](std::uint32_t var, std::uint32_t inst, std::uint32_t block,
+                 Definition::Kind kind) {
+    eventList.push_back(
+        Event{true, static_cast<std::uint32_t>(defs.size())});
+    defs.push_back(Definition{var, inst, block, kind});
+  };
+  auto use = [&](std::uint32_t var, std::uint32_t block, std::uint32_t inst) {
+    if (var == noInst) return;
+    eventList.push_back(
+        Event{false, static_cast<std::uint32_t>(useList.size())});
+    useList.push_back(Use{var, block, inst});
+  };
+
+  // The Loop instruction of the loop each block enters or closes, if any,
+  // and the bindings made inside the loop whose variable names them. The
+  // blocks of a loop are the ones from its header to its latch.
+  std::vector<std::uint32_t> loopAt(fn.blocks.size(), noInst);
+  std::vector<bool> madeInLoop(fn.insts.size(), false);
+  for (std::uint32_t i = 0; i < fn.insts.size(); i++) {
+    if (fn.insts[i].op != IROpcode::Loop) continue;
+    std::span<const IROperand> ops = fn.operandsOf(fn.insts[i]);
+    std::uint32_t latch = ops[5].index;
+    loopAt[ops[4].index] = loopAt[latch] = i;
+    std::uint32_t var = ops.size() > 6 ? variable(ops[6]) : noInst;
+    if (var == noInst) continue;
+    std::uint32_t block = fn.insts[bindings[var]].block;
+    if (fn.blocks[latch].succs[0] <= block && block <= latch) {
+      madeInLoop[bindings[var]] = true;
+    }
+  }
+
+  for (std::uint32_t b = 0; b < fn.blocks.size(); b++) {
+    const IRBlock& block = fn.blocks[b];
+    eventOffsets.push_back(static_cast<std::uint32_t>(eventList.size()));
+    for (std::uint32_t i = block.firstInst; i < block.endInst; i++) {
+      const IRInstruction& inst = fn.insts[i];
+      std::span<const IROperand> ops = fn.operandsOf(inst);
+      switch (inst.op) {
+        case IROpcode::Phi:
+          // Read at the ends of the branches, below.
+          break;
+        case IROpcode::Loop:
+          // Reads and writes at the ends of the entry and latch, below.
+          break;
+        case IROpcode::Binary:
+          if (inst.binop == '=' && variable(ops[0]) != noInst) {
+            use(variable(ops[1]), b, i);
+            def(variable(ops[0]), i, b, Definition::Write);
+            break;
+          }
+          [[fallthrough]];
+        default:
+          for (const IROperand& op : ops) {
+            use(variable(op), b, i);
+          }
+          if ((inst.op == IROpcode::Param ||
+               inst.op == IROpcode::Undeclared ||
+               inst.op == IROpcode::Bind) &&
+              !madeInLoop[i]) {
+            def(varOf[inst.id - fn.firstId], i, b, Definition::Write);
+          }
+      }
+    }
+    if (loopAt[b] != noInst) {
+      std::uint32_t loop = loopAt[b];
+      std::span<const IROperand> ops = fn.operandsOf(fn.insts[loop]);
+      std::uint32_t var = ops.size() > 6 ? variable(ops[6]) : noInst;
+      if (b == ops[4].index) {
+        use(variable(ops[0]), b, loop);
+        if (var != noInst) def(var, loop, b, Definition::LoopStart);
+      } else {
+        use(variable(ops[2]), b, loop);
+        use(var, b, loop);
+        if (var != noInst) def(var, loop, b, Definition::LoopStep);
+      }
+    }
+    // A phi takes the value its operand has at the end of the branch it
+    // comes from: (head, then value, then block, else value, else block).
+    for (std::uint32_t succ : block.succs) {
+      const IRBlock& join = fn.blocks[succ];
+      for (std::uint32_t i = join.firstInst;
+           i < join.endInst && fn.insts[i].op == IROpcode::Phi; i++) {
+        std::span<const IROperand> ops = fn.operandsOf(fn.insts[i]);
+        for (std::size_t k = 1; k + 1 < ops.size(); k += 2) {
+          if (ops[k + 1].index == b) use(variable(ops[k]), b, i);
+        }
+      }
+    }
+    if (block.term == IRTerminator::CondBr ||
+        block.term == IRTerminator::Ret) {
+      use(variable(IROperand{IROperand::Value,
+                             static_cast<std::uint32_t>(block.cond)}),
+          b, noInst);
+    }
+  }
+  eventOffsets.push_back(static_cast<std::uint32_t>(eventList.size()));
+
+  // Renumber the definitions by variable, keeping program order within
+  // each.
+  varDefOffsets.assign(size() + 1, 0);
+  for (const Definition& d : defs) {
+    varDefOffsets[d.var + 1]++;
+  }
+  for (std::size_t v = 0; v < size(); v++) {
+    varDefOffsets[v + 1] += varDefOffsets[v];
+  }
+  std::vector<std::uint32_t> renumbered(defs.size());
+  std::vector<Definition> grouped(defs.size());
+  std::vector<std::uint32_t> fill(varDefOffsets.begin(),
+                                  varDefOffsets.end() - 1);
+  for (std::uint32_t d = 0; d < defs.size(); d++) {
+    renumbered[d] = fill[defs[d].var]++;
+    grouped[renumbered[d]] = defs[d];
+  }
+  defs.swap(grouped);
+  for (Event& e : eventList) {
+    if (e.def) e.index = renumbered[e.index];
+  }
+}
+
+BitSolution liveVariables(const IRFunction& fn,
+                          const FunctionVariables& vars) {
+  BitProblem problem;
+  problem.direction = BitProblem::Backward;
+  problem.bits = vars.size();
+  problem.boundary = DenseBitset(vars.size());
+  problem.gen.assign(fn.blocks.size(), DenseBitset(vars.size()));
+  problem.kill.assign(fn.blocks.size(), DenseBitset(vars.size()));
+  std::span<const FunctionVariables::Definition> defs = vars.definitions();
+  std::span<const FunctionVariables::Use> uses = vars.uses();
+  for (std::uint32_t b = 0; b < fn.blocks.size(); b++) {
+    // Reads of a variable before the block writes it.
+    for (const FunctionVariables::Event& e : vars.events(b)) {
+      if (e.def) {
+        problem.kill[b].set(defs[e.index].var);
+      } else if (!problem.kill[b].test(uses[e.index].var)) {
+        problem.gen[b].set(uses[e.index].var);
+      }
+    }
+  }
+  return solveBitProblem(fn, problem);
+}
+
+BitSolution reachingDefinitions(const IRFunction& fn,
+                                const FunctionVariables& vars) {
+  std::span<const FunctionVariables::Definition> defs = vars.definitions();
+  BitProblem problem;
+  problem.bits = defs.size();
+  problem.boundary = DenseBitset(defs.size());
+  problem.gen.assign(fn.blocks.size(), DenseBitset(defs.size()));
+  problem.kill.assign(fn.blocks.size(), DenseBitset(defs.size()));
+  for (std::uint32_t b = 0; b < fn.blocks.size(); b++) {
+    // A write kills every definition of its variable, the ones in this
+    // block included, and the last write of each variable survives.
+    for (const FunctionVariables::Event& e : vars.events(b)) {
+      if (!e.def) continue;
+      std::uint32_t var = defs[e.index].var;
+      problem.kill[b].setRange(vars.firstDefinition(var),
+                               vars.firstDefinition(var + 1));
+      problem.gen[b].resetRange(vars.firstDefinition(var),
+                                vars.firstDefinition(var + 1));
+      problem.gen[b].set(e.index);
+    }
+  }
+  return solveBitProblem(fn, problem);
+}
+
+DefUseChains::DefUseChains(const IRFunction& fn,
+                           const FunctionVariables& vars,
+                           const BitSolution& reaching) {
+  std::span<const FunctionVariables::Definition> defs = vars.definitions();
+  std::span<const FunctionVariables::Use> uses = vars.uses();
+  // Uses are numbered in block order, so their chains come out in order.
+  useDefOffsets.reserve(uses.size() + 1);
+  DenseBitset current(defs.size());
+  for (std::uint32_t b = 0; b < fn.blocks.size(); b++) {
+    current = reaching.in[b];
+    for (const FunctionVariables::Event& e : vars.events(b)) {
+      if (e.def) {
+        std::uint32_t var = defs[e.index].var;
+        current.resetRange(vars.firstDefinition(var),
+                           vars.firstDefinition(var + 1));
+        current.set(e.index);
+        continue;
+      }
+      useDefOffsets.push_back(static_cast<std::uint32_t>(useDefList.size()));
+      std::uint32_t var = uses[e.index].var;
+      std::size_t last = vars.firstDefinition(var + 1);
+      for (std::size_t d = current.findNext(vars.firstDefinition(var));
+           d < last; d = current.findNext(d + 1)) {
+        useDefList.push_back(static_cast<std::uint32_t>(d));
+      }
+    }
+  }
+  useDefOffsets.push_back(static_cast<std::uint32_t>(useDefList.size()));
+
+  defUseOffsets.assign(defs.size() + 1, 0);
+  for (std::uint32_t d : useDefList) {
+    defUseOffsets[d + 1]++;
+  }
+  for (std::size_t d = 0; d < defs.size(); d++) {
+    defUseOffsets[d + 1] += defUseOffsets[d];
+  }
+  defUseList.resize(useDefList.size());
+  std::vector<std::uint32_t> fill(defUseOffsets.begin(),
+                                  defUseOffsets.end() - 1);
+  for (std::uint32_t u = 0; u < uses.size(); u++) {
+    for (std::uint32_t d : definitionsOf(u)) {
+      defUseList[fill[d]++] = u;
+    }
+  }
+}
+
+void printDataflow(AnalysisSession& session) {
+  IRWriter& out = session.out;
+  const SymbolTable& symbols = session.symbols;
+  out << "\nDATAFLOW:\n";
+  for (const IRFunction& fn : session.ir.functions) {
+    FunctionVariables vars(fn);
+    BitSolution live = liveVariables(fn, vars);
+    BitSolution reaching = reachingDefinitions(fn, vars);
+    DefUseChains chains(fn, vars, reaching);
+    std::span<const FunctionVariables::Definition> defs = vars.definitions();
+    std::span<const FunctionVariables::Use> uses = vars.uses();
+
+    // Variables by name, with the id of their binding if the name is bound
+    // more than once; definitions and uses by the id of their instruction,
+    // with the writes of a for loop marked "start" and "step".
+    SymbolMap<std::uint32_t> bound;
+    for (std::uint32_t v = 0; v < vars.size(); v++) {
+      Symbol name = fn.insts[vars.binding(v)].sym;
+      bound[name]++;
+    }
+    auto variable = [&](std::size_t v) {
+      const IRInstruction& binding = fn.insts[vars.binding(v)];
+      std::string name(symbols.name(binding.sym));
+      if (bound.at(binding.sym) > 1) {
+        name += "(%" + std::to_string(binding.id) + ")";
+      }
+      return name;
+    };
+    auto definition = [&](std::size_t d) {
+      std::string label = "%" + std::to_string(fn.insts[defs[d].inst].id);
+      switch (defs[d].kind) {
+        case FunctionVariables::Definition::LoopStart:
+          return label + " start";
+        case FunctionVariables::Definition::LoopStep:
+          return label + " step";
+        default:
+          return label;
+      }
+    };
+    auto use = [&](std::uint32_t u) {
+      const FunctionVariables::Use& at = uses[u];
+      if (at.inst == FunctionVariables::noInst ||
+          fn.insts[at.inst].block != at.block) {
+        return "end of B" + std::to_string(at.block);
+      }
+      return "%" + std::to_string(fn.insts[at.inst].id);
+    };
+    auto variables = [&](const DenseBitset& members) {
+      if (members.count() == 0) out << " -";
+      members.forEach([&](std::size_t v) { out << ' ' << variable(v); });
+    };
+    // In program order rather than grouped by variable.
+    std::vector<std::pair<int, std::uint32_t>> ordered;
+    auto definitions = [&](const DenseBitset& members) {
+      ordered.clear();
+      members.forEach([&](std::size_t d) {
+        ordered.emplace_back(fn.insts[defs[d].inst].id,
+                             static_cast<std::uint32_t>(d));
+      });
+      std::sort(ordered.begin(), ordered.end());
+      if (ordered.empty()) out << " -";
+      for (const auto& [id, d] : ordered) {
+        out << ' ' << definition(d);
+      }
+    };
+
+    out << '\n' << symbols.name(fn.name) << ": " << vars.size()
+        << (vars.size() == 1 ? " variable, " : " variables, ") << defs.size()
+        << (defs.size() == 1 ? " definition, " : " definitions, ")
+        << uses.size() << (uses.size() == 1 ? " use" : " uses")
+        << "; liveness in " << live.passes
+        << (live.passes == 1 ? " pass" : " passes")
+        << ", reaching definitions in " << reaching.passes
+        << (reaching.passes == 1 ? " pass\n" : " passes\n");
+    for (std::uint32_t b = 0; b < fn.blocks.size(); b++) {
+      out << "  B" << b << ": live in";
+      variables(live.in[b]);
+      out << ", live out";
+      variables(live.out[b]);
+      out << ", reaching in";
+      definitions(reaching.in[b]);
+      out << ", reaching out";
+      definitions(reaching.out[b]);
+      out << '\n';
+    }
+    for (std::uint32_t d = 0; d < defs.size(); d++) {
+      out << "  " << definition(d) << " defines " << variable(defs[d].var);
+      std::span<const std::uint32_t> readers = chains.usesOf(d);
+      if (readers.empty()) out << ", never read";
+      const char* separator = ", read at ";
+      for (std::uint32_t u : readers) {
+        out << separator << use(u);
+        separator = ", ";
+      }
+      out << '\n';
+    }
+    for (std::uint32_t u = 0; u < uses.size(); u++) {
+      out << "  " << use(u) << " reads " << variable(uses[u].var);
+      std::span<const std::uint32_t> writers = chains.definitionsOf(u);
+      if (writers.empty()) out << ", never defined";
+      const char* separator = " from ";
+      for (std::uint32_t d : writers) {
+        out << separator << definition(d);
+        separator = ", ";
+      }
+      out << '\n';
+    }
+  }
+}
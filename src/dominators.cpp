@@ -0,0 +1,239 @@
+#include "../include/dominators.h"
+
+#include "../include/parser.h"
+
+DominatorTree::DominatorTree(const IRFunction& fn, Kind kind)
+    : treeKind(kind) {
+  auto numBlocks = static_cast<std::uint32_t>(fn.blocks.size());
+  if (kind == PostDominators) {
+    for (std::uint32_t b = 0; b < numBlocks; b++) {
+      if (fn.blocks[b].term == IRTerminator::Ret) rootBlock = b;
+    }
+  }
+  build(fn);
+  number();
+  findFrontiers(fn);
+}
+
+// Lengauer-Tarjan over the depth-first (preorder) numbers of the blocks
+// reachable from the root; in the loops below v, w and u are such numbers.
+void DominatorTree::build(const IRFunction& fn) {
+  auto numBlocks = static_cast<std::uint32_t>(fn.blocks.size());
+  bool post = treeKind == PostDominators;
+  auto forward = [&](std::uint32_t b) -> const std::vector<std::uint32_t>& {
+    return post ? fn.blocks[b].preds : fn.blocks[b].succs;
+  };
+  auto backward = [&](std::uint32_t b) -> const std::vector<std::uint32_t>& {
+    return post ? fn.blocks[b].succs : fn.blocks[b].preds;
+  };
+
+  std::vector<std::uint32_t> numberOf(numBlocks, noBlock);
+  std::vector<std::uint32_t> vertex;
+  std::vector<std::uint32_t> parent;
+  vertex.reserve(numBlocks);
+  parent.reserve(numBlocks);
+  struct Frame {
+    std::uint32_t block;
+    std::uint32_t next;  // index into forward(block)
+  };
+  std::vector<Frame> stack{Frame{rootBlock, 0}};
+  numberOf[rootBlock] = 0;
+  vertex.push_back(rootBlock);
+  parent.push_back(noBlock);
+  while (!stack.empty()) {
+    Frame& frame = stack.back();
+    const std::vector<std::uint32_t>& succs = forward(frame.block);
+    if (frame.next == succs.size()) {
+      stack.pop_back();
+      continue;
+    }
+    std::uint32_t succ = succs[frame.next++];
+    if (numberOf[succ] != noBlock) continue;
+    numberOf[succ] = static_cast<std::uint32_t>(vertex.size());
+    parent.push_back(numberOf[frame.block]);
+    vertex.push_back(succ);
+    stack.push_back(Frame{succ, 0});
+  }
+
+  auto n = static_cast<std::uint32_t>(vertex.size());
+  std::vector<std::uint32_t> semi(n);
+  std::vector<std::uint32_t> label(n);
+  std::vector<std::uint32_t> ancestor(n, noBlock);
+  std::vector<std::uint32_t> dom(n, 0);
+  // bucket[v] holds the vertices whose semidominator is v, as a linked
+  // list through bucketNext.
+  std::vector<std::uint32_t> bucket(n, noBlock);
+  std::vector<std::uint32_t> bucketNext(n, noBlock);
+  for (std::uint32_t v = 0; v < n; v++) {
+    semi[v] = label[v] = v;
+  }
+
+  // The vertex with the smallest semidominator on the forest path from v
+  // up to (not including) its root, compressing the path on the way.
+  std::vector<std::uint32_t> path;
+  auto eval = [&](std::uint32_t v) {
+    if (ancestor[v] == noBlock) return v;
+    path.clear();
+    for (std::uint32_t x = v; ancestor[ancestor[x]] != noBlock;
+         x = ancestor[x]) {
+      path.push_back(x);
+    }
+    for (std::size_t i = path.size(); i-- > 0;) {
+      std::uint32_t x = path[i];
+      std::uint32_t a = ancestor[x];
+      if (semi[label[a]] < semi[label[x]]) label[x] = label[a];
+      ancestor[x] = ancestor[a];
+    }
+    return label[v];
+  };
+
+  for (std::uint32_t w = n; w-- > 1;) {
+    for (std::uint32_t pred : backward(vertex[w])) {
+      std::uint32_t v = numberOf[pred];
+      if (v == noBlock) continue;
+      std::uint32_t u = eval(v);
+      if (semi[u] < semi[w]) semi[w] = semi[u];
+    }
+    bucketNext[w] = bucket[semi[w]];
+    bucket[semi[w]] = w;
+    std::uint32_t p = parent[w];
+    ancestor[w] = p;
+    for (std::uint32_t v = bucket[p]; v != noBlock; v = bucketNext[v]) {
+      std::uint32_t u = eval(v);
+      dom[v] = semi[u] < semi[v] ? u : p;
+    }
+    bucket[p] = noBlock;
+  }
+  for (std::uint32_t w = 1; w < n; w++) {
+    if (dom[w] != semi[w]) dom[w] = dom[dom[w]];
+  }
+
+  idoms.assign(numBlocks, noBlock);
+  for (std::uint32_t w = 1; w < n; w++) {
+    idoms[vertex[w]] = vertex[dom[w]];
+  }
+}
+
+// Children lists and the depth-first numbering of the tree.
+void DominatorTree::number() {
+  auto numBlocks = static_cast<std::uint32_t>(idoms.size());
+  childOffsets.assign(numBlocks + 1, 0);
+  for (std::uint32_t b = 0; b < numBlocks; b++) {
+    if (idoms[b] != noBlock) childOffsets[idoms[b] + 1]++;
+  }
+  for (std::uint32_t b = 0; b < numBlocks; b++) {
+    childOffsets[b + 1] += childOffsets[b];
+  }
+  childList.resize(childOffsets[numBlocks]);
+  std::vector<std::uint32_t> fill(childOffsets.begin(), childOffsets.end() - 1);
+  for (std::uint32_t b = 0; b < numBlocks; b++) {
+    if (idoms[b] != noBlock) childList[fill[idoms[b]]++] = b;
+  }
+
+  enter.assign(numBlocks, noBlock);
+  leave.assign(numBlocks, noBlock);
+  depths.assign(numBlocks, 0);
+  std::uint32_t next = 0;
+  struct Frame {
+    std::uint32_t block;
+    std::uint32_t child;  // index into children(block)
+  };
+  std::vector<Frame> stack{Frame{rootBlock, 0}};
+  enter[rootBlock] = next++;
+  while (!stack.empty()) {
+    Frame& frame = stack.back();
+    std::span<const std::uint32_t> kids = children(frame.block);
+    if (frame.child == kids.size()) {
+      leave[frame.block] = next;
+      stack.pop_back();
+      continue;
+    }
+    std::uint32_t kid = kids[frame.child++];
+    enter[kid] = next++;
+    depths[kid] = depths[frame.block] + 1;
+    stack.push_back(Frame{kid, 0});
+  }
+}
+
+// A block b is in the frontier of every block on the tree path from each of
+// its predecessors up to, but not including, idom(b); for a block with one
+// predecessor that path is empty, unless the block is the root. Blocks are
+// visited in increasing order, so each frontier comes out sorted. A runner
+// that already has b has had it added by an earlier predecessor, and so
+// has everything above it.
+void DominatorTree::findFrontiers(const IRFunction& fn) {
+  auto numBlocks = static_cast<std::uint32_t>(idoms.size());
+  bool post = treeKind == PostDominators;
+  std::vector<std::uint32_t> from;  // (block, frontier block) pairs
+  std::vector<std::uint32_t> to;
+  std::vector<std::uint32_t> lastAdded(numBlocks, noBlock);
+  for (std::uint32_t b = 0; b < numBlocks; b++) {
+    const std::vector<std::uint32_t>& preds =
+        post ? fn.blocks[b].succs : fn.blocks[b].preds;
+    if (!reachable(b)) continue;
+    for (std::uint32_t pred : preds) {
+      if (!reachable(pred)) continue;
+      for (std::uint32_t runner = pred; runner != idoms[b];
+           runner = idoms[runner]) {
+        if (lastAdded[runner] == b) break;
+        lastAdded[runner] = b;
+        from.push_back(runner);
+        to.push_back(b);
+      }
+    }
+  }
+
+  frontierOffsets.assign(numBlocks + 1, 0);
+  for (std::uint32_t runner : from) {
+    frontierOffsets[runner + 1]++;
+  }
+  for (std::uint32_t b = 0; b < numBlocks; b++) {
+    frontierOffsets[b + 1] += frontierOffsets[b];
+  }
+  frontierList.resize(from.size());
+  std::vector<std::uint32_t> fill(frontierOffsets.begin(),
+                                  frontierOffsets.end() - 1);
+  for (std::size_t i = 0; i < from.size(); i++) {
+    frontierList[fill[from[i]]++] = to[i];
+  }
+}
+
+void printDominatorTrees(AnalysisSession& session) {
+  IRWriter& out = session.out;
+  auto blocks = [&](std::span<const std::uint32_t> list) {
+    if (list.empty()) {
+      out << " -";
+      return;
+    }
+    for (std::uint32_t b : list) {
+      out << " B" << b;
+    }
+  };
+  auto block = [&](std::uint32_t b) {
+    if (b == DominatorTree::noBlock) {
+      out << '-';
+    } else {
+      out << 'B' << b;
+    }
+  };
+
+  out << "\nDOMINATOR TREES:\n";
+  for (const IRFunction& fn : session.ir.functions) {
+    DominatorTree dom(fn, DominatorTree::Dominators);
+    DominatorTree postDom(fn, DominatorTree::PostDominators);
+    out << '\n' << session.symbols.name(fn.name) << ": " << fn.blocks.size()
+        << (fn.blocks.size() == 1 ? " block" : " blocks") << ", exit B"
+        << postDom.root() << '\n';
+    for (std::uint32_t b = 0; b < fn.blocks.size(); b++) {
+      out << "  B" << b << ": idom ";
+      block(dom.idom(b));
+      out << ", ipdom ";
+      block(postDom.idom(b));
+      out << ", frontier";
+      blocks(dom.frontier(b));
+      out << ", post-frontier";
+      blocks(postDom.frontier(b));
+      out << '\n';
+    }
+  }
+}
@@ -1,37 +1,82 @@
-#include "../include/parser.h"
+#include <cstdio>
+#include <thread>
 
-extern int getNextToken();
+#include "../include/parser.h"
 
-std::ifstream file;
 std::string fileName;
 
 bool printControl = false;
+bool printSummary = false;
 bool printFunc = false;
-
-extern bool genDefinition();
-extern void printControlFlow();
-extern void printFuncCat();
-
-static void handleDefinition() {
-  if (!genDefinition()) {
-    getNextToken();
+bool printMemory = false;
+bool parallelParse = false;
+bool binaryIR = false;
+bool quiet = false;
+bool printPaths = false;
+bool explore = false;
+bool printDominators = false;
+bool printDataflow = false;
+bool printLoops = false;
+std::vector<std::string> pathRequests;
+std::vector<std::string> sampleRequests;
+Budgets budgets;
+
+static void handleDefinition(AnalysisSession& session) {
+  if (!session.genDefinition()) {
+    session.parser.getNextToken();
   }
 }
 
-static void mainLoop() {
+static void mainLoop(AnalysisSession& session) {
+  Parser& parser = session.parser;
   while (true) {
-    switch (curTok) {
+    switch (parser.curTok) {
       case tok_eof:
         return;
       case ';':
         // fprintf(stderr, "Ready>>");
-        getNextToken();
+        parser.getNextToken();
         break;
       case tok_def:
-        handleDefinition();
+        handleDefinition(session);
+        break;
+      default:
+        parser.getNextToken();
+        break;
+    }
+  }
+}
+
+// Same walk over the tokens as mainLoop(), but every definition has already
+// been parsed by parseDefinitionsParallel(); only the traversal, which has to
+// see the definitions in source order, runs here.
+static void parallelMainLoop(AnalysisSession& session) {
+  std::vector<ParsedDefinition> defs =
+      session.parseDefinitionsParallel(std::thread::hardware_concurrency());
+  Parser& parser = session.parser;
+  std::size_t next = 0;
+
+  while (true) {
+    switch (parser.curTok) {
+      case tok_eof:
+        return;
+      case tok_def: {
+        std::size_t here = parser.curTokIndex();
+        while (defs[next].start < here) {
+          next++;
+        }
+        ParsedDefinition& def = defs[next];
+        session.reportErrors(def.errors);
+        parser.seekToken(def.resume);
+        if (def.fn) {
+          session.traverseDefinition(def.fn);
+        } else {
+          parser.getNextToken();
+        }
         break;
+      }
       default:
-        getNextToken();
+        parser.getNextToken();
         break;
     }
   }
@@ -62,6 +107,60 @@ int main(int argc, char **argv) {
           case 'f':
             printFunc = true;
             break;
+          case 's':
+            printSummary = true;
+            break;
+          case 'm':
+            printMemory = true;
+            break;
+          case 'p':
+            parallelParse = true;
+            break;
+          case 'b':
+            binaryIR = true;
+            break;
+          case 'q':
+            quiet = true;
+            break;
+          case 'n':
+            printPaths = true;
+            break;
+          case 'e':
+            explore = true;
+            break;
+          case 't':
+            printDominators = true;
+            break;
+          case 'u':
+            printDataflow = true;
+            break;
+          case 'o':
+            printLoops = true;
+            break;
+          case 'd':
+            if (i + 1 == argc) {
+              std::cout << "Missing path after \"-d\"" << std::endl;
+              return 1;
+            }
+            pathRequests.push_back(argv[++i]);
+            break;
+          case 'l':
+            if (i + 1 == argc) {
+              std::cout << "Missing budget after \"-l\"" << std::endl;
+              return 1;
+            }
+            if (!budgets.parse(argv[++i])) {
+              std::cout << "Invalid budget \"" << argv[i] << "\"" << std::endl;
+              return 1;
+            }
+            break;
+          case 'r':
+            if (i + 1 == argc) {
+              std::cout << "Missing walk count after \"-r\"" << std::endl;
+              return 1;
+            }
+            sampleRequests.push_back(argv[++i]);
+            break;
           default:
             std::cout << "Invalid argument \"" << argv[i] << "\"" << std::endl;
             return 1;
@@ -73,28 +172,53 @@ int main(int argc, char **argv) {
     }
   }
 
-  file.open(fileName, std::ios::in);
+  AnalysisSession session;
+  session.binOpPrecedence[':'] = 1;
+  session.binOpPrecedence['='] = 2;
+  session.binOpPrecedence['<'] = 10;
+  session.binOpPrecedence['+'] = 20;
+  session.binOpPrecedence['-'] = 20;
+  session.binOpPrecedence['*'] = 40;
 
-  if (!file.is_open()) {
+  // fprintf(stderr, "Ready>>");
+  if (!session.open(fileName)) {
     std::cout << "Could not open file \"" << fileName << "\"" << std::endl;
     return 1;
   }
+  if (binaryIR) session.out.setFormat(IRWriter::Format::Binary);
+  session.emitIR = !quiet;
+  session.budgets = budgets;
 
-  binOpPrecedence[':'] = 1;
-  binOpPrecedence['='] = 2;
-  binOpPrecedence['<'] = 10;
-  binOpPrecedence['+'] = 20;
-  binOpPrecedence['-'] = 20;
-  binOpPrecedence['*'] = 40;
+  if (parallelParse)
+    parallelMainLoop(session);
+  else
+    mainLoop(session);
 
-  // fprintf(stderr, "Ready>>");
-  getNextToken();
+  if(printControl) session.printControlFlow();
+
+  if(printSummary) session.printControlFlowSummary();
+
+  if(printPaths) session.printPathCounts();
+
+  for (const std::string& request : pathRequests) session.printPath(request);
+
+  if(explore) session.printAllPaths(std::thread::hardware_concurrency());
+
+  for (const std::string& request : sampleRequests)
+    session.printPathSamples(request, std::thread::hardware_concurrency());
+
+  if(printDominators) session.printDominators();
+
+  if(printDataflow) session.printDataflow();
+
+  if(printLoops) session.printLoops();
 
-  mainLoop();
+  if(printFunc) session.printFuncCat();
 
-  if(printControl) printControlFlow();
+  if(printMemory) session.printArenaUsage();
 
-  if(printFunc) printFuncCat();
+  session.releaseCompilationUnit();
+  session.lexer.closeSource();
 
   return 0;
 }
\ No newline at end of file
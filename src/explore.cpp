@@ -0,0 +1,207 @@
+#include "../include/explore.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "../include/parser.h"
+#include "../include/pathnumbering.h"
+#include "../include/workpool.h"
+
+namespace {
+
+using Edge = PathNumbering::Edge;
+
+// A block is only split across tasks when at least this many paths go
+// through it; below that, a task costs more than printing the paths.
+constexpr std::uint64_t forkPaths = 256;
+
+struct ExploreTask {
+  std::uint32_t fn = 0;  // index into the explored functions
+  std::uint64_t base = 0;  // sum of the increments along `prefix`
+  std::vector<const Edge*> prefix;  // from the entry to the task's block
+};
+
+// Report lines for the paths fn:first, fn:first + 1, ...
+struct Chunk {
+  std::uint32_t fn;
+  std::uint64_t first;
+  std::uint64_t next;
+  std::string text;
+};
+
+class Explorer {
+ public:
+  // Only the paths of function f with ids below limits[f] are listed.
+  Explorer(std::vector<PathNumbering>& paths,
+           std::vector<std::uint64_t>& limits, unsigned threads)
+      : paths(paths), limits(limits), pool(threads), chunks(pool.workers()) {}
+
+  std::vector<Chunk> run(std::vector<ExploreTask> roots) {
+    pool.run(std::move(roots), [this](unsigned worker, ExploreTask& task) {
+      explore(worker, task);
+    });
+    std::vector<Chunk> all;
+    for (auto& own : chunks) {
+      std::move(own.begin(), own.end(), std::back_inserter(all));
+    }
+    std::sort(all.begin(), all.end(), [](const Chunk& a, const Chunk& b) {
+      return a.fn != b.fn ? a.fn < b.fn : a.first < b.first;
+    });
+    return all;
+  }
+
+ private:
+  struct Frame {
+    std::uint32_t block;
+    std::uint32_t next;  // edgesFrom(block)[next] is the next edge to take
+    std::uint32_t end;
+    std::uint64_t base;
+  };
+
+  void explore(unsigned worker, ExploreTask& task) {
+    const PathNumbering& numbering = paths[task.fn];
+    std::vector<const Edge*>& path = task.prefix;
+    std::uint32_t start = path.empty() ? 0 : path.back()->to;
+    std::vector<Frame> frames{Frame{start, 0, 0, task.base}};
+    frames.back().end = static_cast<std::uint32_t>(
+        numbering.edgesFrom(start).size());
+    forkAt(worker, task.fn, path, frames.back());
+
+    while (!frames.empty()) {
+      Frame& frame = frames.back();
+      if (frame.block == numbering.exitBlock()) {
+        emit(worker, task.fn, frame.base, path);
+      }
+      if (frame.next == frame.end) {
+        // The edge into the task's first block is part of its prefix.
+        if (frames.size() > 1) path.pop_back();
+        frames.pop_back();
+        continue;
+      }
+      const Edge& e = numbering.edgesFrom(frame.block)[frame.next++];
+      if (!belowLimit(task.fn, frame.base, e)) {
+        // So are the paths after it, whose ids are higher still.
+        frame.next = frame.end;
+        continue;
+      }
+      path.push_back(&e);
+      Frame child{e.to, 0,
+                  static_cast<std::uint32_t>(numbering.edgesFrom(e.to).size()),
+                  frame.base + e.increment.saturated()};
+      forkAt(worker, task.fn, path, child);
+      frames.push_back(child);
+    }
+  }
+
+  // Hands every edge out of `frame` but the first to new tasks, if enough
+  // paths go that way.
+  void forkAt(unsigned worker, std::uint32_t fn,
+              const std::vector<const Edge*>& path, Frame& frame) {
+    const PathNumbering& numbering = paths[fn];
+    if (frame.end < 2 ||
+        numbering.pathsFrom(frame.block).saturated() < forkPaths) {
+      return;
+    }
+    std::span<const Edge> edges = numbering.edgesFrom(frame.block);
+    for (std::uint32_t i = frame.end; i-- > 1;) {
+      if (!belowLimit(fn, frame.base, edges[i])) continue;
+      ExploreTask task{fn, frame.base + edges[i].increment.saturated(), path};
+      task.prefix.push_back(&edges[i]);
+      pool.push(worker, std::move(task));
+    }
+    frame.end = 1;
+  }
+
+  // Whether the first path through `e` is listed.
+  bool belowLimit(std::uint32_t fn, std::uint64_t base, const Edge& e) const {
+    return e.increment.saturated() < limits[fn] - base;
+  }
+
+  void emit(unsigned worker, std::uint32_t fn, std::uint64_t id,
+            const std::vector<const Edge*>& path) {
+    std::vector<Chunk>& own = chunks[worker];
+    if (own.empty() || own.back().fn != fn || own.back().next != id) {
+      own.push_back(Chunk{fn, id, id, {}});
+    }
+    Chunk& chunk = own.back();
+    chunk.text += "  " + std::to_string(id) + ": ";
+    PathNumbering::describe(path, chunk.text);
+    chunk.text += '\n';
+    chunk.next = id + 1;
+  }
+
+  std::vector<PathNumbering>& paths;
+  std::vector<std::uint64_t>& limits;
+  WorkStealingPool<ExploreTask> pool;
+  std::vector<std::vector<Chunk>> chunks;  // per worker
+};
+
+}  // namespace
+
+void explorePaths(AnalysisSession& session, unsigned threads) {
+  IRWriter& out = session.out;
+  const std::vector<IRFunction>& functions = session.ir.functions;
+  const Budgets& budgets = session.budgets;
+  constexpr std::uint64_t unlimited = ~std::uint64_t(0);
+  std::vector<PathNumbering> paths;
+  paths.reserve(functions.size());
+  // The paths budgets are spent in function order, from the first path
+  // id up, so they cut the listing in the same place on every run.
+  std::vector<std::uint64_t> limits;
+  std::vector<const char*> cutBy;
+  std::uint64_t runLeft = budgets.perRun.paths ? budgets.perRun.paths
+                                               : unlimited;
+  std::vector<ExploreTask> roots;
+  for (const IRFunction& fn : functions) {
+    paths.emplace_back(fn);
+    // Path ids are 64-bit here; anything with more paths could not be
+    // listed in full anyway.
+    std::uint64_t limit = paths.back().count().saturated();
+    const char* cut = nullptr;
+    if (budgets.perFunction.paths && limit > budgets.perFunction.paths) {
+      limit = budgets.perFunction.paths;
+      cut = "its";
+    }
+    if (limit > runLeft) {
+      limit = runLeft;
+      cut = "the run's";
+    }
+    if (limit == unlimited) {
+      limit = 0;
+    } else {
+      runLeft -= runLeft == unlimited ? 0 : limit;
+    }
+    limits.push_back(limit);
+    cutBy.push_back(cut);
+    if (limit > 0) {
+      roots.push_back(
+          ExploreTask{static_cast<std::uint32_t>(paths.size() - 1), 0, {}});
+    }
+  }
+
+  std::vector<Chunk> chunks =
+      Explorer(paths, limits, threads).run(std::move(roots));
+
+  out << "\nALL PATHS:\n\n";
+  std::size_t next = 0;
+  for (std::uint32_t f = 0; f < functions.size(); f++) {
+    const BigUint& count = paths[f].count();
+    out << session.symbols.name(functions[f].name) << ": " << count.toString()
+        << (count == BigUint(1) ? " path" : " paths");
+    if (cutBy[f]) {
+      out << ", first " << limits[f] << " listed (over " << cutBy[f]
+          << " paths budget)";
+    } else if (count.saturated() == unlimited) {
+      out << ", too many to list\n";
+      continue;
+    }
+    out << '\n';
+    for (; next < chunks.size() && chunks[next].fn == f; next++) {
+      out << chunks[next].text;
+    }
+  }
+}
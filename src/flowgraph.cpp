@@ -0,0 +1,513 @@
+#include "../include/flowgraph.h"
+
+#include <chrono>
+#include <unordered_set>
+
+#include "../include/summary.h"
+#include "../include/visitor.h"
+
+void FlowGraph::clear() {
+  kinds.clear();
+  payloads.clear();
+  lines.clear();
+  funcEnds.clear();
+  owners.clear();
+  numbers.clear();
+  succOffsets.clear();
+  succList.clear();
+  predOffsets.clear();
+  predList.clear();
+  blocks.clear();
+  blockStarts.clear();
+  blockSuccOffsets.clear();
+  blockSuccList.clear();
+  blockPredOffsets.clear();
+  blockPredList.clear();
+  functions.clear();
+}
+
+namespace {
+
+// The 32-bit payload FlowGraph keeps for each kind of node; numbers are
+// appended to `numbers` and referred to by index.
+struct NodePayload {
+  std::vector<double>& numbers;
+
+  std::uint32_t operator()(ExprAST&) { return 0; }
+  std::uint32_t operator()(NumberExprAST& n) {
+    numbers.push_back(n.val);
+    return static_cast<std::uint32_t>(numbers.size() - 1);
+  }
+  std::uint32_t operator()(VariableExprAST& n) { return n.name; }
+  std::uint32_t operator()(BinaryExprAST& n) {
+    return static_cast<unsigned char>(n.op);
+  }
+  std::uint32_t operator()(UnaryExprAST& n) {
+    return static_cast<unsigned char>(n.op);
+  }
+  std::uint32_t operator()(PrototypeAST& n) { return n.name; }
+  std::uint32_t operator()(FunctionAST& n) { return n.proto->name; }
+  std::uint32_t operator()(CallExprAST& n) { return n.callee; }
+  std::uint32_t operator()(IfExprAST& n) {
+    return static_cast<std::uint32_t>(n.cond->startNode->loc.line);
+  }
+};
+
+// Fills a CSR edge list from `count` per-source lists; `edges(i, emit)`
+// calls emit(target) for every edge of source i.
+template <typename Edges>
+void fillCSR(std::size_t count, std::vector<std::uint32_t>& offsets,
+             std::vector<std::uint32_t>& list, Edges edges) {
+  offsets.resize(count + 1);
+  for (std::size_t i = 0; i < count; i++) {
+    offsets[i] = static_cast<std::uint32_t>(list.size());
+    edges(i, [&](std::uint32_t target) { list.push_back(target); });
+  }
+  offsets[count] = static_cast<std::uint32_t>(list.size());
+}
+
+// Reverses a CSR edge list over `count` nodes.
+void transposeCSR(std::size_t count, const std::vector<std::uint32_t>& offsets,
+                  const std::vector<std::uint32_t>& list,
+                  std::vector<std::uint32_t>& revOffsets,
+                  std::vector<std::uint32_t>& revList) {
+  revOffsets.assign(count + 1, 0);
+  for (std::uint32_t target : list) {
+    revOffsets[target + 1]++;
+  }
+  for (std::size_t i = 0; i < count; i++) {
+    revOffsets[i + 1] += revOffsets[i];
+  }
+  revList.resize(list.size());
+  std::vector<std::uint32_t> fill(revOffsets.begin(), revOffsets.end() - 1);
+  for (std::size_t i = 0; i < count; i++) {
+    for (std::uint32_t e = offsets[i]; e < offsets[i + 1]; e++) {
+      revList[fill[list[e]]++] = static_cast<std::uint32_t>(i);
+    }
+  }
+}
+
+}  // namespace
+
+// Numbers every node reachable from a defined function, splits the nodes
+// into basic blocks and lays the blocks out one after the other, then
+// copies the per-node fields and control edges into the flat arrays.
+void FlowGraph::build(const SymbolMap<FunctionAST*>& definedFunctions) {
+  clear();
+
+  // Discovery order. ExprAST::graphNode remembers the number, which is
+  // only trusted if it points back at the node (it may be left over from
+  // an earlier build).
+  std::vector<ExprAST*> nodes;
+  std::vector<ExprAST*> stack;
+  auto isNumbered = [&](ExprAST* node) {
+    return node->graphNode < nodes.size() && nodes[node->graphNode] == node;
+  };
+  auto number = [&](ExprAST* node) {
+    if (!isNumbered(node)) {
+      node->graphNode = static_cast<NodeId>(nodes.size());
+      nodes.push_back(node);
+      stack.push_back(node);
+    }
+    return node->graphNode;
+  };
+
+  std::vector<Symbol> fns = definedFunctions.keys();
+  for (Symbol fn : fns) {
+    number(definedFunctions.at(fn));
+    while (!stack.empty()) {
+      ExprAST* node = stack.back();
+      stack.pop_back();
+      for (ExprAST* succ : node->controlEdgesTo) {
+        number(succ);
+      }
+    }
+  }
+
+  std::size_t n = nodes.size();
+  auto endsBlock = [](const ExprAST* node) {
+    return node->controlEdgesTo.size() != 1 || node->isFuncEnd;
+  };
+  std::vector<std::uint32_t> predCount(n, 0);
+  std::vector<bool> leader(n, false);
+  for (ExprAST* node : nodes) {
+    for (ExprAST* succ : node->controlEdgesTo) {
+      predCount[succ->graphNode]++;
+      if (endsBlock(node)) leader[succ->graphNode] = true;
+    }
+  }
+  for (std::size_t i = 0; i < n; i++) {
+    if (predCount[i] != 1) leader[i] = true;
+  }
+  for (Symbol fn : fns) {
+    leader[definedFunctions.at(fn)->graphNode] = true;
+  }
+
+  // Every node that does not start a block has a single predecessor, which
+  // has it as single successor, so following the chains from the leaders
+  // places each node exactly once.
+  std::vector<NodeId> order;
+  order.reserve(n);
+  for (std::size_t i = 0; i < n; i++) {
+    if (!leader[i]) continue;
+    blockStarts.push_back(static_cast<NodeId>(order.size()));
+    ExprAST* node = nodes[i];
+    while (true) {
+      order.push_back(node->graphNode);
+      if (endsBlock(node)) break;
+      ExprAST* succ = node->controlEdgesTo[0];
+      if (leader[succ->graphNode]) break;
+      node = succ;
+    }
+  }
+  blockStarts.push_back(static_cast<NodeId>(n));
+
+  // From here on graphNode holds the final id.
+  for (std::size_t i = 0; i < n; i++) {
+    nodes[order[i]]->graphNode = static_cast<NodeId>(i);
+  }
+  std::vector<ExprAST*> laidOut(n);
+  for (std::size_t i = 0; i < n; i++) {
+    laidOut[nodes[i]->graphNode] = nodes[i];
+  }
+  nodes.swap(laidOut);
+
+  kinds.resize(n);
+  payloads.resize(n);
+  lines.resize(n);
+  funcEnds.resize(n, noFunc);
+  owners.resize(n);
+  blocks.resize(n);
+  for (NodeId i = 0; i < n; i++) {
+    ExprAST* node = nodes[i];
+    kinds[i] = node->kind;
+    lines[i] = node->loc.line;
+    owners[i] = node->owner;
+    if (node->isFuncEnd) {
+      funcEnds[i] = node->funcDetails.first;
+    }
+    payloads[i] = visitNode(*node, NodePayload{numbers});
+  }
+  fillCSR(n, succOffsets, succList, [&](std::size_t i, auto emit) {
+    for (ExprAST* succ : nodes[i]->controlEdgesTo) {
+      emit(succ->graphNode);
+    }
+  });
+  transposeCSR(n, succOffsets, succList, predOffsets, predList);
+
+  std::size_t numBlocks = blockCount();
+  for (BlockId b = 0; b < numBlocks; b++) {
+    for (NodeId i = blockBegin(b); i < blockEnd(b); i++) {
+      blocks[i] = b;
+    }
+  }
+  fillCSR(numBlocks, blockSuccOffsets, blockSuccList,
+          [&](std::size_t b, auto emit) {
+            for (NodeId succ : succs(blockEnd(b) - 1)) {
+              emit(blocks[succ]);
+            }
+          });
+  transposeCSR(numBlocks, blockSuccOffsets, blockSuccList, blockPredOffsets,
+               blockPredList);
+
+  for (Symbol fn : fns) {
+    FunctionAST* f = definedFunctions.at(fn);
+    ExprAST* last = f->body->lastNode;
+    functions[fn] = FunctionNodes{
+        f->graphNode, isNumbered(last) ? last->graphNode : noNode};
+  }
+}
+
+std::size_t FlowGraph::bytes() const {
+  auto size = [](const auto& v) {
+    return v.capacity() * sizeof(v[0]);
+  };
+  return size(kinds) + size(payloads) + size(lines) + size(funcEnds) +
+         size(owners) + size(numbers) + size(succOffsets) + size(succList) +
+         size(predOffsets) + size(predList) + size(blocks) +
+         size(blockStarts) + size(blockSuccOffsets) + size(blockSuccList) +
+         size(blockPredOffsets) + size(blockPredList);
+}
+
+// CHECK CONTROL FLOW
+
+// Reproduces the path walk of the original recursive showControl(): every
+// node keeps a cursor into its successor list that advances (modulo the
+// list length) each time the node is left, and a function's last node skips
+// an IfCont it has already returned into for that function. The cursors
+// belong to the walk rather than to the nodes, and IfExprAST's "False"
+// continuation is kept on an explicit stack, so long paths do not recurse.
+// Only the last node of a block has a choice to make; the walk runs
+// through the rest of the block without consulting the edges.
+//
+// Under budgets (-l) every printed node, started path, byte of report and
+// slice of wall time is charged to the run and to the function the node is
+// in. A function over its budget is truncated: the walk leaves it for
+// whatever follows its last node, skips it from then on, and the report
+// ends with its path count and callees instead. A run over its budget
+// ends the walk.
+class ControlFlowPrinter {
+ public:
+  explicit ControlFlowPrinter(AnalysisSession& session)
+      : graph(session.flowGraph),
+        out(session.out),
+        symbols(session.symbols),
+        budgets(session.budgets),
+        controlTo(graph.size(), 0) {}
+
+  void run(NodeId entry) {
+    if (budgets.limited()) {
+      walk<true>(entry);
+    } else {
+      walk<false>(entry);
+    }
+  }
+
+  // The truncation part of the report; nothing if the walk was not cut.
+  void printTruncations(AnalysisSession& session) {
+    if (!stoppedBy && truncated.empty()) {
+      return;
+    }
+    out << "\nTRUNCATED:\n\n";
+    if (stoppedBy) {
+      out << "run: over its " << stoppedBy << " budget after "
+          << runUse.nodes << " nodes and " << runUse.paths
+          << (runUse.paths == 1 ? " path\n" : " paths\n");
+    }
+    // The cheaper summary of each truncated function: its acyclic path
+    // count and the functions it calls.
+    SummaryTable table(session.ir.functions);
+    for (const auto& [fn, reason] : truncated) {
+      out << symbols.name(fn) << ": over its " << reason << " budget";
+      if (const FunctionSummary* s = table.get(fn)) {
+        out << "; " << (s->paths == ~std::uint64_t(0) ? "at least " : "")
+            << s->paths << (s->paths == 1 ? " path" : " paths");
+        SymbolMap<int> listed;
+        const char* separator = ", calls ";
+        for (const CallSite& call : s->calls) {
+          if (listed.contains(call.callee)) continue;
+          listed.insert(call.callee, 1);
+          out << separator << symbols.name(call.callee);
+          separator = ", ";
+        }
+      }
+      out << '\n';
+    }
+  }
+
+ private:
+  template <bool Metered>
+  void walk(NodeId entry) {
+    std::vector<NodeId> pendingElse;
+    NodeId node = entry;
+    if (Metered && !startPath(entry)) {
+      node = leave(entry);
+    }
+    while (!stoppedBy) {
+      if (node != noNode) {
+        if (Metered && truncatedSet.contains(graph.owner(node))) {
+          out << "[" << symbols.name(graph.owner(node)) << " truncated] -> ";
+          node = leave(node);
+          continue;
+        }
+        NodeId last = graph.blockEnd(graph.blockOf(node)) - 1;
+        bool over = false;
+        for (; node <= last; node++) {
+          printNode(node);
+          if (graph.kind(node) == NodeKind::If) {
+            pendingElse.push_back(node);
+          }
+          if (Metered && !charge(node)) {
+            over = true;
+            break;
+          }
+        }
+        node = over ? leave(node) : next(last);
+        continue;
+      }
+      if (pendingElse.empty()) {
+        break;
+      }
+      NodeId ifNode = pendingElse.back();
+      pendingElse.pop_back();
+      if (Metered && truncatedSet.contains(graph.owner(ifNode))) {
+        continue;
+      }
+      out << " (program exit)";
+      out << "\n\nCondition (line: " << graph.payload(ifNode)
+          << ") False:\n-> ";
+      node = next(ifNode);
+      if (Metered && !startPath(ifNode)) {
+        node = leave(ifNode);
+      }
+    }
+    if (stoppedBy) {
+      out << "[truncated: run over its " << stoppedBy << " budget] -> ";
+    }
+  }
+
+  // Charges a new path to the run and to the function of `node`; false if
+  // that put either over its budget.
+  bool startPath(NodeId node) {
+    runUse.paths++;
+    uses[graph.owner(node)].paths++;
+    return check(node);
+  }
+
+  // Charges the visit of `node`; false if that put the run or its function
+  // over budget.
+  bool charge(NodeId node) {
+    BudgetUse& use = uses[graph.owner(node)];
+    runUse.nodes++;
+    use.nodes++;
+    std::size_t bytes = out.bytesOut();
+    runUse.bytes += bytes - lastBytes;
+    use.bytes += bytes - lastBytes;
+    lastBytes = bytes;
+    // The clock is read every so many nodes, and the time since the last
+    // reading goes to whichever function is current then.
+    if ((runUse.nodes & (clockInterval - 1)) == 0) {
+      auto now = std::chrono::steady_clock::now();
+      runUse.time += now - lastClock;
+      use.time += now - lastClock;
+      lastClock = now;
+    }
+    return check(node);
+  }
+
+  bool check(NodeId node) {
+    if (const char* reason = runUse.exceeded(budgets.perRun)) {
+      stoppedBy = reason;
+      return false;
+    }
+    Symbol fn = graph.owner(node);
+    if (const char* reason = uses[fn].exceeded(budgets.perFunction)) {
+      truncated.emplace_back(fn, reason);
+      truncatedSet.insert(fn, 1);
+      out << "[truncated: " << symbols.name(fn) << " over its " << reason
+          << " budget] -> ";
+      return false;
+    }
+    return true;
+  }
+
+  // Where the walk goes when it skips the rest of `node`'s function: on
+  // from the function's last node, as if the body had run to its end. The
+  // skip counts as a node of the run, so a walk bouncing between truncated
+  // functions still runs out of budget.
+  NodeId leave(NodeId node) {
+    if (!stoppedBy) {
+      runUse.nodes++;
+      stoppedBy = runUse.exceeded(budgets.perRun);
+    }
+    if (stoppedBy) {
+      return noNode;
+    }
+    NodeId exit = graph.exit(graph.owner(node));
+    return exit == noNode ? noNode : next(exit);
+  }
+
+ private:
+  void printNode(NodeId node) {
+    switch (graph.kind(node)) {
+      case NodeKind::Number:
+        out << "NumberExprAST (" << graph.number(node) << ") -> ";
+        break;
+      case NodeKind::Variable:
+        out << "VariableExprAST (" << symbols.name(graph.payload(node))
+            << ") -> ";
+        break;
+      case NodeKind::Var:
+        out << "VarExprAST -> ";
+        break;
+      case NodeKind::Binary:
+        out << "BinaryExprAST (" << static_cast<char>(graph.payload(node))
+            << ") -> ";
+        break;
+      case NodeKind::Unary:
+        out << "UnaryExprAST (" << static_cast<char>(graph.payload(node))
+            << ") -> ";
+        break;
+      case NodeKind::Prototype:
+        out << "PrototypeAST (" << symbols.name(graph.payload(node))
+            << ") -> ";
+        break;
+      case NodeKind::Function:
+        out << "FunctionAST (" << symbols.name(graph.payload(node))
+            << ") -> ";
+        break;
+      case NodeKind::Call:
+        out << "CallExprAST (" << symbols.name(graph.payload(node))
+            << ") -> ";
+        break;
+      case NodeKind::If:
+        out << "IfExprAST\n";
+        out << "\nCondition (line: " << graph.payload(node)
+            << ") True:\n-> ";
+        break;
+      case NodeKind::IfCont:
+        out << "IfCont -> ";
+        break;
+      case NodeKind::For:
+        out << "ForExprAST -> \n";
+        break;
+      case NodeKind::Expr:
+        out << " -> ";
+        break;
+    }
+  }
+
+  // Picks the successor to continue with, or noNode when the path ends.
+  NodeId next(NodeId node) {
+    std::span<const NodeId> succ = graph.succs(node);
+    auto count = static_cast<std::uint32_t>(succ.size());
+    std::uint32_t& cursor = controlTo[node];
+    if (count > 0) {
+      cursor = cursor % count;
+    }
+
+    if (graph.isFuncEnd(node) && count > 0) {
+      NodeId target = succ[cursor];
+      if (graph.kind(target) == NodeKind::IfCont) {
+        // Already returned into this IfCont from this function: take the
+        // next edge instead.
+        std::uint64_t key =
+            std::uint64_t(target) << 32 | graph.funcEnd(node);
+        if (!alreadyReturnedIfcont.insert(key).second) {
+          cursor++;
+        }
+      }
+    }
+
+    if (cursor < count) {
+      return succ[cursor++];
+    }
+    return noNode;
+  }
+
+  static constexpr std::uint64_t clockInterval = 1024;
+
+  const FlowGraph& graph;
+  IRWriter& out;
+  const SymbolTable& symbols;
+  const Budgets& budgets;
+  std::vector<std::uint32_t> controlTo;
+  // (IfCont node, returning function) pairs, packed as node << 32 | symbol.
+  std::unordered_set<std::uint64_t> alreadyReturnedIfcont;
+
+  BudgetUse runUse;
+  SymbolMap<BudgetUse> uses;
+  std::vector<std::pair<Symbol, const char*>> truncated;  // with the reason
+  SymbolMap<int> truncatedSet;
+  const char* stoppedBy = nullptr;  // the run limit that ended the walk
+  std::size_t lastBytes = out.bytesOut();
+  std::chrono::steady_clock::time_point lastClock =
+      std::chrono::steady_clock::now();
+};
+
+void printControlFlowGraph(AnalysisSession& session, NodeId entry) {
+  ControlFlowPrinter printer(session);
+  printer.run(entry);
+  session.out << "(program exit)\n";
+  printer.printTruncations(session);
+}
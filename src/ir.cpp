@@ -0,0 +1,267 @@
+#include "../include/ir.h"
+
+#include <cassert>
+
+void IRBuilder::beginFunction(Symbol name) {
+  functions.emplace_back();
+  fn().name = name;
+  pending.clear();
+  setBlock(newBlock());
+}
+
+void IRBuilder::endFunction(int result) {
+  IRBlock& block = fn().blocks[cur];
+  block.term = IRTerminator::Ret;
+  block.cond = result;
+}
+
+IRInstruction& IRBuilder::append(IROpcode op, int id) {
+  IRFunction& f = fn();
+  IRInstruction& inst = f.insts.emplace_back();
+  inst.op = op;
+  inst.id = id;
+  inst.block = cur;
+  inst.firstOperand = static_cast<std::uint32_t>(f.operands.size());
+  f.blocks[cur].endInst = static_cast<std::uint32_t>(f.insts.size());
+  if (id) {
+    if (f.valueInsts.empty()) f.firstId = id;
+    assert(id == f.firstId + static_cast<int>(f.valueInsts.size()));
+    f.valueInsts.push_back(static_cast<std::uint32_t>(f.insts.size() - 1));
+  }
+  return inst;
+}
+
+void IRBuilder::operand(IROperand::Kind kind, std::uint32_t index) {
+  IRFunction& f = fn();
+  f.operands.push_back(IROperand{kind, index});
+  f.insts.back().numOperands++;
+}
+
+std::uint32_t IRBuilder::newBlock() {
+  fn().blocks.emplace_back();
+  return static_cast<std::uint32_t>(fn().blocks.size() - 1);
+}
+
+void IRBuilder::setBlock(std::uint32_t block) {
+  IRBlock& b = fn().blocks[block];
+  b.firstInst = b.endInst = static_cast<std::uint32_t>(fn().insts.size());
+  cur = block;
+}
+
+void IRBuilder::branch(std::uint32_t to) {
+  auto& blocks = fn().blocks;
+  blocks[cur].term = IRTerminator::Br;
+  blocks[cur].succs.push_back(to);
+  blocks[to].preds.push_back(cur);
+}
+
+void IRBuilder::param(int id, Symbol name) {
+  append(IROpcode::Param, id).sym = name;
+  fn().numParams++;
+}
+
+void IRBuilder::undeclared(int id, Symbol name) {
+  append(IROpcode::Undeclared, id).sym = name;
+}
+
+void IRBuilder::constant(int id, double val) {
+  append(IROpcode::Const, id).val = val;
+}
+
+void IRBuilder::bind(int id, Symbol name, int init) {
+  append(IROpcode::Bind, id).sym = name;
+  operand(IROperand::Value, init);
+}
+
+void IRBuilder::binary(int id, char op, int lhs, int rhs) {
+  append(IROpcode::Binary, id).binop = op;
+  operand(IROperand::Value, lhs);
+  operand(IROperand::Value, rhs);
+}
+
+void IRBuilder::unary(int id, char op, int operandId) {
+  append(IROpcode::Unary, id).binop = op;
+  operand(IROperand::Value, operandId);
+}
+
+void IRBuilder::call(int id, Symbol callee, std::span<const int> args,
+                     bool defined) {
+  IRInstruction& inst = append(IROpcode::Call, id);
+  inst.sym = callee;
+  inst.external = !defined;
+  for (int arg : args) {
+    operand(IROperand::Value, arg);
+  }
+}
+
+void IRBuilder::scopeBegin() {
+  append(IROpcode::ScopeBegin, 0);
+}
+
+void IRBuilder::scopeEnd() {
+  append(IROpcode::ScopeEnd, 0);
+}
+
+// The else block is only created once the then branch is done, so blocks
+// are numbered (and their instructions stored) in traversal order.
+void IRBuilder::beginThen(int cond) {
+  std::uint32_t head = cur;
+  std::uint32_t then = newBlock();
+  IRBlock& b = fn().blocks[head];
+  b.term = IRTerminator::CondBr;
+  b.cond = cond;
+  b.succs.push_back(then);
+  fn().blocks[then].preds.push_back(head);
+  pending.push_back(head);
+  setBlock(then);
+}
+
+void IRBuilder::beginElse() {
+  std::uint32_t head = pending.back();
+  std::uint32_t thenEnd = cur;
+  std::uint32_t _else = newBlock();
+  fn().blocks[head].succs.push_back(_else);
+  fn().blocks[_else].preds.push_back(head);
+  pending.push_back(thenEnd);
+  setBlock(_else);
+}
+
+void IRBuilder::endIf(int id, int thenValue, int elseValue) {
+  std::uint32_t thenEnd = pending.back();
+  pending.pop_back();
+  std::uint32_t head = pending.back();
+  pending.pop_back();
+  std::uint32_t elseEnd = cur;
+
+  // Preds in then/else order, matching the phi operands.
+  std::uint32_t join = newBlock();
+  cur = thenEnd;
+  branch(join);
+  cur = elseEnd;
+  branch(join);
+  setBlock(join);
+
+  append(IROpcode::Phi, id);
+  operand(IROperand::Block, head);
+  operand(IROperand::Value, thenValue);
+  operand(IROperand::Block, thenEnd);
+  operand(IROperand::Value, elseValue);
+  operand(IROperand::Block, elseEnd);
+}
+
+void IRBuilder::beginLoop() {
+  std::uint32_t header = newBlock();
+  branch(header);
+  pending.push_back(header);
+  setBlock(header);
+}
+
+void IRBuilder::beginLoopBody(int cond) {
+  std::uint32_t condEnd = cur;
+  std::uint32_t body = newBlock();
+  IRBlock& b = fn().blocks[condEnd];
+  b.term = IRTerminator::CondBr;
+  b.cond = cond;
+  b.succs.push_back(body);
+  fn().blocks[body].preds.push_back(condEnd);
+  pending.push_back(condEnd);
+  setBlock(body);
+}
+
+void IRBuilder::beginLoopStep() {
+  std::uint32_t step = newBlock();
+  branch(step);
+  setBlock(step);
+}
+
+void IRBuilder::endLoop(int id, Symbol var, int start, int cond, int step,
+                        int body, int binding) {
+  std::uint32_t condEnd = pending.back();
+  pending.pop_back();
+  std::uint32_t header = pending.back();
+  pending.pop_back();
+
+  std::uint32_t entry = fn().blocks[header].preds[0];
+  std::uint32_t latch = cur;
+  branch(header);
+  std::uint32_t exit = newBlock();
+  fn().blocks[condEnd].succs.push_back(exit);
+  fn().blocks[exit].preds.push_back(condEnd);
+  setBlock(exit);
+
+  append(IROpcode::Loop, id).sym = var;
+  operand(IROperand::Value, start);
+  operand(IROperand::Value, cond);
+  operand(IROperand::Value, step);
+  operand(IROperand::Value, body);
+  operand(IROperand::Block, entry);
+  operand(IROperand::Block, latch);
+  if (binding) operand(IROperand::Value, binding);
+}
+
+void printIR(const IRFunction& fn, const SymbolTable& symbols,
+             IRWriter& out) {
+  out << "\nFUNCTION AST TRAVERSAL (Generated IR): \n";
+  out.function(fn.name);
+  std::vector<int> args;
+  for (std::uint32_t i = 0; i < fn.insts.size(); i++) {
+    if (i == fn.numParams) {
+      out << '\n';
+    }
+    const IRInstruction& inst = fn.insts[i];
+    auto ops = fn.operandsOf(inst);
+    switch (inst.op) {
+      case IROpcode::Param:
+        out.variable(inst.id, inst.sym);
+        break;
+      case IROpcode::Undeclared:
+        out << "Error: Variable undeclared. Proceeding by inserting a dummy "
+               "declaration.\n";
+        out.variable(inst.id, inst.sym);
+        break;
+      case IROpcode::Const:
+        out.constant(inst.id, inst.val);
+        break;
+      case IROpcode::Bind:
+        out.variable(inst.id, inst.sym);
+        out.copy(inst.id, ops[0].index);
+        break;
+      case IROpcode::Binary:
+        out.binary(inst.id, ops[0].index, inst.binop, ops[1].index);
+        break;
+      case IROpcode::Unary:
+        // The text form has always shown the operand id in place of the
+        // operator.
+        out.unary(inst.id, ops[0].index);
+        break;
+      case IROpcode::Call:
+        if (inst.external) {
+          out << "Error: Function " << symbols.name(inst.sym)
+              << " not defined. Proceeding assuming a definition exists.\n";
+        }
+        args.clear();
+        for (const IROperand& op : ops) {
+          args.push_back(op.index);
+        }
+        out.call(inst.id, inst.sym, args);
+        break;
+      case IROpcode::Phi:
+        out.ifExpr(inst.id, fn.blocks[ops[0].index].cond, ops[1].index,
+                   ops[3].index);
+        break;
+      case IROpcode::Loop:
+        out.forExpr(inst.id, inst.sym, ops[0].index, ops[1].index,
+                    ops[2].index, ops[3].index);
+        break;
+      case IROpcode::ScopeBegin:
+        out << "Var Expression:\n";
+        break;
+      case IROpcode::ScopeEnd:
+        out << "end of Var Expression\n";
+        break;
+    }
+  }
+  if (fn.insts.size() == fn.numParams) {
+    out << '\n';
+  }
+}
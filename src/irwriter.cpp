@@ -0,0 +1,351 @@
+#include "../include/irwriter.h"
+
+#include <cerrno>
+#include <cstring>
+
+void IRWriter::setFormat(Format f) {
+  fmt = f;
+  if (fmt == Format::Binary) {
+    buf.append(magic, sizeof(magic));
+    buf.push_back(static_cast<char>(version));
+  }
+}
+
+IRWriter& IRWriter::operator<<(double value) {
+  char tmp[32];
+  auto res = std::to_chars(tmp, tmp + sizeof(tmp), value,
+                           std::chars_format::general, 6);
+  return *this << std::string_view(tmp, res.ptr - tmp);
+}
+
+void IRWriter::flush() {
+  spill();
+}
+
+void IRWriter::spill() {
+  if (fmt == Format::Binary) {
+    emitPendingText();
+  }
+  const char* p = buf.data();
+  std::size_t left = buf.size();
+  while (left > 0) {
+    ssize_t n = ::write(fd, p, left);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      break;  // Nowhere left to report it; drop the output like cout would.
+    }
+    p += n;
+    left -= n;
+    written += n;
+  }
+  buf.clear();
+}
+
+void IRWriter::putVarint(std::uint64_t v) {
+  while (v >= 0x80) {
+    buf.push_back(static_cast<char>(v | 0x80));
+    v >>= 7;
+  }
+  buf.push_back(static_cast<char>(v));
+}
+
+void IRWriter::putDouble(double v) {
+  static_assert(sizeof(double) == 8);
+  std::uint64_t bits;
+  std::memcpy(&bits, &v, sizeof(bits));
+  for (int i = 0; i < 8; i++) {
+    buf.push_back(static_cast<char>(bits >> (8 * i)));
+  }
+}
+
+void IRWriter::emitPendingText() {
+  if (pendingText.empty()) return;
+  buf.push_back(static_cast<char>(op_text));
+  putVarint(pendingText.size());
+  buf.append(pendingText);
+  pendingText.clear();
+}
+
+void IRWriter::beginRecord(IROp op) {
+  emitPendingText();
+  buf.push_back(static_cast<char>(op));
+}
+
+void IRWriter::nameSymbol(Symbol sym) {
+  if (sym < namedSymbols.size() && namedSymbols[sym]) return;
+  if (sym >= namedSymbols.size()) namedSymbols.resize(sym + 1, false);
+  namedSymbols[sym] = true;
+  const std::string& text = symbols.name(sym);
+  beginRecord(op_name);
+  putVarint(sym);
+  putVarint(text.size());
+  buf.append(text);
+}
+
+void IRWriter::function(Symbol name) {
+  if (fmt == Format::Text) {
+    *this << "Function: " << symbols.name(name) << '\n';
+    return;
+  }
+  nameSymbol(name);
+  beginRecord(op_function);
+  putVarint(name);
+  endRecord();
+}
+
+void IRWriter::constant(int id, double val) {
+  if (fmt == Format::Text) {
+    *this << '%' << id << " : (const number) " << val << '\n';
+    return;
+  }
+  beginRecord(op_constant);
+  putId(id);
+  putDouble(val);
+  endRecord();
+}
+
+void IRWriter::variable(int id, Symbol name) {
+  if (fmt == Format::Text) {
+    *this << '%' << id << " : " << symbols.name(name) << " (variable)\n";
+    return;
+  }
+  nameSymbol(name);
+  beginRecord(op_variable);
+  putId(id);
+  putVarint(name);
+  endRecord();
+}
+
+void IRWriter::copy(int id, int src) {
+  if (fmt == Format::Text) {
+    *this << '%' << id << " = %" << src << '\n';
+    return;
+  }
+  beginRecord(op_copy);
+  putId(id);
+  putId(src);
+  endRecord();
+}
+
+void IRWriter::binary(int id, int lhs, char op, int rhs) {
+  if (fmt == Format::Text) {
+    *this << '%' << id << " = %" << lhs << ' ' << op << " %" << rhs << '\n';
+    return;
+  }
+  beginRecord(op_binary);
+  putId(id);
+  putId(lhs);
+  buf.push_back(op);
+  putId(rhs);
+  endRecord();
+}
+
+void IRWriter::unary(int id, int operand) {
+  if (fmt == Format::Text) {
+    *this << '%' << id << " = " << operand << '\n';
+    return;
+  }
+  beginRecord(op_unary);
+  putId(id);
+  putId(operand);
+  endRecord();
+}
+
+void IRWriter::call(int id, Symbol callee, std::span<const int> args) {
+  if (fmt == Format::Text) {
+    *this << '%' << id << " = call " << symbols.name(callee) << '(';
+    for (std::size_t i = 0; i < args.size(); i++) {
+      *this << (i ? ", %" : "%") << args[i];
+    }
+    *this << ")\n";
+    return;
+  }
+  nameSymbol(callee);
+  beginRecord(op_call);
+  putId(id);
+  putVarint(callee);
+  putVarint(args.size());
+  for (int arg : args) {
+    putId(arg);
+  }
+  endRecord();
+}
+
+void IRWriter::ifExpr(int id, int cond, int then, int _else) {
+  if (fmt == Format::Text) {
+    *this << '%' << id << " = if %" << cond << " then %" << then
+          << " else %" << _else << '\n';
+    return;
+  }
+  beginRecord(op_if);
+  putId(id);
+  putId(cond);
+  putId(then);
+  putId(_else);
+  endRecord();
+}
+
+void IRWriter::forExpr(int id, Symbol var, int start, int cond, int step,
+                       int body) {
+  if (fmt == Format::Text) {
+    *this << '%' << id << " = for " << symbols.name(var) << " = %" << start
+          << " to %" << cond << " step %" << step << " do %" << body << '\n';
+    return;
+  }
+  nameSymbol(var);
+  beginRecord(op_for);
+  putId(id);
+  putVarint(var);
+  putId(start);
+  putId(cond);
+  putId(step);
+  putId(body);
+  endRecord();
+}
+
+namespace {
+
+// Bounds-checked cursor over a Binary stream.
+struct BinaryReader {
+  const unsigned char* cur;
+  const unsigned char* end;
+  bool ok = true;
+
+  std::uint64_t varint() {
+    std::uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      if (cur == end) break;
+      unsigned char b = *cur++;
+      v |= std::uint64_t(b & 0x7f) << shift;
+      if (!(b & 0x80)) return v;
+    }
+    ok = false;
+    return 0;
+  }
+  int id() { return static_cast<int>(static_cast<std::uint32_t>(varint())); }
+  unsigned char byte() {
+    if (cur == end) {
+      ok = false;
+      return 0;
+    }
+    return *cur++;
+  }
+  double dbl() {
+    std::uint64_t bits = 0;
+    for (int i = 0; i < 8; i++) bits |= std::uint64_t(byte()) << (8 * i);
+    double v;
+    std::memcpy(&v, &bits, sizeof(v));
+    return v;
+  }
+  std::string_view bytes(std::uint64_t n) {
+    if (n > static_cast<std::uint64_t>(end - cur)) {
+      ok = false;
+      return {};
+    }
+    std::string_view s(reinterpret_cast<const char*>(cur), n);
+    cur += n;
+    return s;
+  }
+};
+
+}  // namespace
+
+bool decodeBinaryIR(std::string_view data, SymbolTable& symbols,
+                    IRWriter& out) {
+  if (data.size() < sizeof(IRWriter::magic) + 1 ||
+      data.compare(0, sizeof(IRWriter::magic),
+                   std::string_view(IRWriter::magic,
+                                    sizeof(IRWriter::magic))) != 0 ||
+      static_cast<unsigned char>(data[sizeof(IRWriter::magic)]) !=
+          IRWriter::version) {
+    return false;
+  }
+  auto begin = reinterpret_cast<const unsigned char*>(data.data());
+  BinaryReader in{begin + sizeof(IRWriter::magic) + 1, begin + data.size()};
+
+  // Stream symbols to symbols of `symbols`.
+  SymbolMap<Symbol> names;
+  auto symbol = [&]() -> Symbol {
+    auto sym = static_cast<Symbol>(in.varint());
+    if (!names.contains(sym)) {
+      in.ok = false;
+      return 0;
+    }
+    return names.at(sym);
+  };
+
+  std::vector<int> args;
+  while (in.ok && in.cur != in.end) {
+    switch (in.byte()) {
+      case IRWriter::op_text:
+        out << in.bytes(in.varint());
+        break;
+      case IRWriter::op_name: {
+        auto sym = static_cast<Symbol>(in.varint());
+        std::string_view text = in.bytes(in.varint());
+        names[sym] = symbols.intern(text);
+        break;
+      }
+      case IRWriter::op_function:
+        out.function(symbol());
+        break;
+      case IRWriter::op_constant: {
+        int id = in.id();
+        out.constant(id, in.dbl());
+        break;
+      }
+      case IRWriter::op_variable: {
+        int id = in.id();
+        out.variable(id, symbol());
+        break;
+      }
+      case IRWriter::op_copy: {
+        int id = in.id();
+        out.copy(id, in.id());
+        break;
+      }
+      case IRWriter::op_binary: {
+        int id = in.id();
+        int lhs = in.id();
+        char op = static_cast<char>(in.byte());
+        out.binary(id, lhs, op, in.id());
+        break;
+      }
+      case IRWriter::op_unary: {
+        int id = in.id();
+        out.unary(id, in.id());
+        break;
+      }
+      case IRWriter::op_call: {
+        int id = in.id();
+        Symbol callee = symbol();
+        std::uint64_t n = in.varint();
+        args.clear();
+        for (std::uint64_t i = 0; i < n && in.ok; i++) {
+          args.push_back(in.id());
+        }
+        out.call(id, callee, args);
+        break;
+      }
+      case IRWriter::op_if: {
+        int id = in.id();
+        int cond = in.id();
+        int then = in.id();
+        out.ifExpr(id, cond, then, in.id());
+        break;
+      }
+      case IRWriter::op_for: {
+        int id = in.id();
+        Symbol var = symbol();
+        int start = in.id();
+        int cond = in.id();
+        int step = in.id();
+        out.forExpr(id, var, start, cond, step, in.id());
+        break;
+      }
+      default:
+        return false;
+    }
+  }
+  return in.ok;
+}
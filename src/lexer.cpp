@@ -1,96 +1,246 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <array>
+#include <charconv>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <string>
-#include <fstream>
 
 #include "../include/lexExtern.h"
 
-std::string identifierStr;
-double numVal;
+bool LexerContext::openSource(const std::string& name) {
+  int fd = open(name.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map != MAP_FAILED) {
+      madvise(map, st.st_size, MADV_SEQUENTIAL);
+      source.begin = static_cast<const char*>(map);
+      source.mappedSize = st.st_size;
+    }
+  }
+
+  if (!source.mappedSize) {
+    // Pipes, character devices and the like: one bulk read.
+    char chunk[1 << 16];
+    ssize_t n;
+    while ((n = read(fd, chunk, sizeof(chunk))) > 0) {
+      source.owned.append(chunk, n);
+    }
+    source.begin = source.owned.data();
+  }
+  close(fd);
+
+  source.end = source.begin + (source.mappedSize ? source.mappedSize
+                                                 : source.owned.size());
+  source.cur = source.begin;
+  lastPos = source.begin;
+  lastChar = ' ';
+  lexLoc = {1, 0};
+  return true;
+}
+
+void LexerContext::closeSource() {
+  if (source.mappedSize) {
+    munmap(const_cast<char*>(source.begin), source.mappedSize);
+  }
+  source = SourceBuffer();
+  identifierStr = std::string_view();
+  numStr = std::string_view();
+  lastPos = nullptr;
+}
+
+// Character classes for the ASCII range; anything else (including the
+// truncated EOF marker) has no class. Equivalent to the "C" locale
+// isspace/isalpha/isdigit without the per-call locale lookup.
+enum CharClass : unsigned char {
+  cc_space = 1,
+  cc_alpha = 2,
+  cc_digit = 4,
+};
+
+static constexpr std::array<unsigned char, 256> makeCharClassTable() {
+  std::array<unsigned char, 256> table{};
+  for (int c : {' ', '\t', '\n', '\v', '\f', '\r'}) table[c] = cc_space;
+  for (int c = 'a'; c <= 'z'; c++) table[c] = cc_alpha;
+  for (int c = 'A'; c <= 'Z'; c++) table[c] = cc_alpha;
+  for (int c = '0'; c <= '9'; c++) table[c] = cc_digit;
+  return table;
+}
 
-SourceLocation curLoc;
-SourceLocation lexLoc = {1, 0};
+static constexpr auto charClass = makeCharClassTable();
 
-extern int advance() {
-  int lastChar = file.get();
+static inline bool isSpaceChar(int c) {
+  return charClass[static_cast<unsigned char>(c)] & cc_space;
+}
+static inline bool isAlphaChar(int c) {
+  return charClass[static_cast<unsigned char>(c)] & cc_alpha;
+}
+static inline bool isDigitChar(int c) {
+  return charClass[static_cast<unsigned char>(c)] & cc_digit;
+}
+static inline bool isAlnumChar(int c) {
+  return charClass[static_cast<unsigned char>(c)] & (cc_alpha | cc_digit);
+}
 
-  if (lastChar == '\n' || lastChar == '\r') {
+// Keywords are found through a perfect hash over (length, first char, last
+// char); the static_assert below rejects any table where two keywords share
+// a slot, so a lookup is one hash and at most one comparison.
+struct Keyword {
+  std::string_view text;
+  int tok;
+};
+
+static constexpr Keyword keywords[] = {
+    {"def", tok_def},       {"DEF", tok_def},       {"define", tok_def},
+    {"extern", tok_extern}, {"EXTERN", tok_extern}, {"if", tok_if},
+    {"IF", tok_if},         {"then", tok_then},     {"THEN", tok_then},
+    {"else", tok_else},     {"ELSE", tok_else},     {"for", tok_for},
+    {"FOR", tok_for},       {"when", tok_when},     {"WHEN", tok_when},
+    {"inc", tok_inc},       {"INC", tok_inc},       {"do", tok_do},
+    {"DO", tok_do},         {"binary", tok_binary}, {"unary", tok_unary},
+    {"var", tok_var},       {"VAR", tok_var},       {"in", tok_in},
+    {"IN", tok_in},
+};
+
+static constexpr std::size_t keywordSlots = 64;
+
+static constexpr std::size_t keywordHash(std::string_view s) {
+  return (2 * s.size() + static_cast<unsigned char>(s.front()) +
+          14 * static_cast<unsigned char>(s.back())) &
+         (keywordSlots - 1);
+}
+
+static constexpr std::array<Keyword, keywordSlots> makeKeywordTable() {
+  std::array<Keyword, keywordSlots> table{};
+  for (auto& slot : table) slot = {"", tok_identifier};
+  for (auto& kw : keywords) table[keywordHash(kw.text)] = kw;
+  return table;
+}
+
+static constexpr auto keywordTable = makeKeywordTable();
+
+static constexpr bool keywordTableIsPerfect() {
+  for (auto& kw : keywords) {
+    if (keywordTable[keywordHash(kw.text)].text != kw.text) return false;
+  }
+  return true;
+}
+static_assert(keywordTableIsPerfect(), "keyword hash has a collision");
+
+static inline int lookupKeyword(std::string_view s) {
+  const Keyword& kw = keywordTable[keywordHash(s)];
+  return kw.text == s ? kw.tok : tok_identifier;
+}
+
+int LexerContext::advance() {
+  lastPos = source.cur;
+  int c = EOF;
+  if (source.cur < source.end) {
+    c = static_cast<unsigned char>(*source.cur++);
+  }
+
+  if (c == '\n' || c == '\r') {
     lexLoc.line++;
     lexLoc.col = 0;
   } else {
     lexLoc.col++;
   }
   curLoc = lexLoc;
-  return lastChar;
+  return c;
 }
 
-extern int getToken() {
-  static char lastChar = ' ';
+// Skips the rest of a '#' comment without lexing it. Stops in front of the
+// line terminator so advance() still does the line bookkeeping for it.
+void LexerContext::skipComment() {
+  const char* cur = source.cur;
+  std::size_t len = source.end - cur;
+  const char* eol = static_cast<const char*>(std::memchr(cur, '\n', len));
+  if (!eol) eol = source.end;
+  // Lone '\r' line endings are rare; look for one only before the '\n'.
+  if (const void* cr = std::memchr(cur, '\r', eol - cur)) {
+    eol = static_cast<const char*>(cr);
+  }
+  lexLoc.col += eol - cur;
+  source.cur = eol;
+}
 
-  while (isspace(lastChar)) {
+int LexerContext::getToken() {
+  while (true) {
+    while (isSpaceChar(lastChar)) {
+      lastChar = advance();
+    }
+    if (lastChar != '#') {
+      break;
+    }
+    skipComment();
     lastChar = advance();
   }
 
-  if (isalpha(lastChar)) {
-    identifierStr.erase();
-    identifierStr.push_back(lastChar);
-
-    while (isalnum(lastChar = advance())) {
-      identifierStr.push_back(lastChar);
-    }
+  if (isAlphaChar(lastChar)) {
+    const char* start = lastPos;
 
-    if (identifierStr == "def" || identifierStr == "DEF" ||
-        identifierStr == "define") {
-      return tok_def;
-    } else if (identifierStr == "extern" || identifierStr == "EXTERN") {
-      return tok_extern;
-    } else if (identifierStr == "if" || identifierStr == "IF") {
-      return tok_if;
-    } else if (identifierStr == "then" || identifierStr == "THEN") {
-      return tok_then;
-    } else if (identifierStr == "else" || identifierStr == "ELSE") {
-      return tok_else;
-    } else if (identifierStr == "for" || identifierStr == "FOR") {
-      return tok_for;
-    } else if (identifierStr == "when" || identifierStr == "WHEN") {
-      return tok_when;
-    } else if (identifierStr == "inc" || identifierStr == "INC") {
-      return tok_inc;
-    } else if (identifierStr == "do" || identifierStr == "DO") {
-      return tok_do;
-    } else if (identifierStr == "binary") {
-      return tok_binary;
-    } else if (identifierStr == "unary") {
-      return tok_unary;
-    } else if (identifierStr == "var" || identifierStr == "VAR") {
-      return tok_var;
-    } else if (identifierStr == "in" || identifierStr == "IN") {
-      return tok_in;
-    } else {
-      return tok_identifier;
-    }
-  } else if (isdigit(lastChar) || lastChar == '.') {
-    std::string numStr;
     do {
-      numStr.push_back(lastChar);
       lastChar = advance();
-    } while (isdigit(lastChar) || lastChar == '.');
+    } while (isAlnumChar(lastChar));
+    identifierStr = std::string_view(start, lastPos - start);
 
-    numVal = strtod(numStr.c_str(), 0);
-    return tok_number;
-  } else if (lastChar == '#') {
+    int tok = lookupKeyword(identifierStr);
+    if (tok == tok_identifier) {
+      identifierSym = symbols.intern(identifierStr);
+    }
+    return tok;
+  } else if (isDigitChar(lastChar) || lastChar == '.') {
+    const char* start = lastPos;
     do {
-      lastChar = getToken();
-    } while (lastChar != EOF && lastChar != '\n' && lastChar != '\r');
+      lastChar = advance();
+    } while (isDigitChar(lastChar) || lastChar == '.');
+    numStr = std::string_view(start, lastPos - start);
 
-    if (lastChar != EOF) {
-      return getToken();
-    } else {
-      return tok_eof;
+    numVal = 0;
+    auto [end, ec] = std::from_chars(numStr.data(),
+                                     numStr.data() + numStr.size(), numVal);
+    if (ec == std::errc::result_out_of_range) {
+      // from_chars leaves the value alone; keep strtod's HUGE_VAL/0 result.
+      numVal = strtod(std::string(numStr).c_str(), 0);
     }
+    return tok_number;
   }
 
   int thisChar = lastChar;
   lastChar = advance();
   return thisChar;
 }
+
+// Lexes the whole source into `tokens` so the parser can consume it by index
+// (and look ahead or back up) instead of pulling from getToken().
+void LexerContext::lexAll() {
+  tokens.clear();
+  constantPool.clear();
+  tokens.reserve((source.end - source.begin) / 4 + 1);
+
+  int tok;
+  do {
+    tok = getToken();
+    TokenEntry entry;
+    entry.payload = 0;
+    if (tok == tok_identifier) {
+      entry.payload = identifierSym;
+    } else if (tok == tok_number) {
+      entry.payload = static_cast<std::uint32_t>(constantPool.size());
+      constantPool.push_back(numVal);
+    }
+    entry.line = curLoc.line;
+    entry.col = curLoc.col;
+    entry.kind = static_cast<char>(tok);
+    tokens.push_back(entry);
+  } while (static_cast<char>(tok) != tok_eof);
+}
@@ -0,0 +1,309 @@
+#include "../include/loops.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "../include/dataflow.h"
+#include "../include/parser.h"
+
+namespace {
+
+// Trip count of `for v = start when cond inc step`, where cond is
+// `v < bound` (below) or `bound < v`: the condition is checked before every
+// run of the body, and the step is added after it. Integers that stay
+// exact as doubles are counted with one division; anything else is stepped
+// in doubles exactly as the loop would, up to a million runs.
+TripCount constantTripCount(double start, double step, double bound,
+                            bool below) {
+  auto holds = [&](double v) { return below ? v < bound : bound < v; };
+  if (!holds(start)) return {TripCount::Exact, 0};
+  // Never towards the bound; NaN falls through and ends after one run.
+  if (below ? step <= 0 : step >= 0) return {TripCount::Endless, 0};
+
+  constexpr double exact = 4503599627370496.0;  // 2^52
+  auto integral = [&](double v) {
+    return std::abs(v) <= exact && std::trunc(v) == v;
+  };
+  if (integral(start) && integral(step) && integral(bound)) {
+    auto distance = static_cast<std::int64_t>(below ? bound - start
+                                                    : start - bound);
+    auto stride = static_cast<std::int64_t>(below ? step : -step);
+    return {TripCount::Exact,
+            static_cast<std::uint64_t>((distance + stride - 1) / stride)};
+  }
+
+  constexpr std::uint64_t limit = 1 << 20;
+  std::uint64_t count = 0;
+  for (double v = start; holds(v); v += step) {
+    if (count == limit) return {TripCount::Unknown, 0};
+    count++;
+  }
+  return {TripCount::Exact, count};
+}
+
+}  // namespace
+
+LoopForest::LoopForest(const IRFunction& fn, const DominatorTree& dominators) {
+  auto numBlocks = static_cast<std::uint32_t>(fn.blocks.size());
+
+  // Headers and their latches, in the order the loops are discovered.
+  struct Found {
+    std::uint32_t header;
+    std::vector<std::uint32_t> latches;
+    std::uint32_t parent = noLoop;
+    std::uint32_t top = 0;  // union-find towards the outermost loop found yet
+  };
+  std::vector<Found> found;
+  for (std::uint32_t h = 0; h < numBlocks; h++) {
+    if (!dominators.reachable(h)) continue;
+    std::vector<std::uint32_t> latches;
+    for (std::uint32_t t : fn.blocks[h].preds) {
+      if (dominators.reachable(t) && dominators.dominates(h, t)) {
+        latches.push_back(t);
+      }
+    }
+    if (!latches.empty()) {
+      std::sort(latches.begin(), latches.end());
+      latches.erase(std::unique(latches.begin(), latches.end()),
+                    latches.end());
+      found.push_back(Found{h, std::move(latches)});
+    }
+  }
+  // A loop nested in another has a header the outer header strictly
+  // dominates, so deeper headers go first.
+  std::stable_sort(found.begin(), found.end(),
+                   [&](const Found& a, const Found& b) {
+                     return dominators.depth(a.header) >
+                            dominators.depth(b.header);
+                   });
+  auto outermost = [&](std::uint32_t l) {
+    while (found[l].top != l) {
+      found[l].top = found[found[l].top].top;
+      l = found[l].top;
+    }
+    return l;
+  };
+
+  std::vector<std::uint32_t> discovered(numBlocks, noLoop);
+  std::vector<std::uint32_t> work;
+  for (std::uint32_t l = 0; l < found.size(); l++) {
+    found[l].top = l;
+    std::uint32_t header = found[l].header;
+    work.assign(found[l].latches.begin(), found[l].latches.end());
+    while (!work.empty()) {
+      std::uint32_t b = work.back();
+      work.pop_back();
+      if (discovered[b] == noLoop) {
+        discovered[b] = l;
+        if (b == header) continue;
+      } else {
+        std::uint32_t inner = outermost(discovered[b]);
+        if (inner == l) continue;
+        found[inner].parent = l;
+        found[inner].top = l;
+        b = found[inner].header;
+      }
+      for (std::uint32_t p : fn.blocks[b].preds) {
+        if (dominators.reachable(p)) work.push_back(p);
+      }
+    }
+  }
+
+  // Number the loops in preorder of the forest, siblings by header.
+  std::vector<std::uint32_t> order(found.size());
+  for (std::uint32_t l = 0; l < found.size(); l++) order[l] = l;
+  std::sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) {
+    return found[a].header < found[b].header;
+  });
+  std::vector<std::vector<std::uint32_t>> children(found.size());
+  std::vector<std::uint32_t> roots;
+  for (std::uint32_t l : order) {
+    (found[l].parent == noLoop ? roots : children[found[l].parent])
+        .push_back(l);
+  }
+  std::vector<std::uint32_t> number(found.size());
+  all.reserve(found.size());
+  struct Frame {
+    std::uint32_t loop;  // in found
+    std::uint32_t next;  // index into its children
+  };
+  std::vector<Frame> stack;
+  for (std::uint32_t root : roots) {
+    stack.push_back(Frame{root, 0});
+    while (!stack.empty()) {
+      Frame& frame = stack.back();
+      std::uint32_t l = frame.loop;
+      if (frame.next == 0) {
+        auto n = static_cast<std::uint32_t>(all.size());
+        number[l] = n;
+        std::uint32_t parent =
+            found[l].parent == noLoop ? noLoop : number[found[l].parent];
+        std::uint32_t depth = parent == noLoop ? 1 : all[parent].depth + 1;
+        all.push_back(Loop{found[l].header, parent, depth, 0, 0,
+                           std::move(found[l].latches), {}, {}});
+      }
+      if (frame.next == children[l].size()) {
+        all[number[l]].end = static_cast<std::uint32_t>(all.size());
+        stack.pop_back();
+        continue;
+      }
+      std::uint32_t child = children[l][frame.next++];
+      stack.push_back(Frame{child, 0});
+    }
+  }
+
+  innermost.assign(numBlocks, noLoop);
+  for (std::uint32_t b = 0; b < numBlocks; b++) {
+    if (discovered[b] != noLoop) {
+      innermost[b] = number[discovered[b]];
+      all[innermost[b]].numBlocks++;
+    }
+  }
+  for (auto l = static_cast<std::uint32_t>(all.size()); l-- > 0;) {
+    if (all[l].parent != noLoop) {
+      all[all[l].parent].numBlocks += all[l].numBlocks;
+    }
+  }
+  // An edge leaves every loop that contains its source but not its target.
+  for (std::uint32_t b = 0; b < numBlocks; b++) {
+    for (std::uint32_t s : fn.blocks[b].succs) {
+      for (std::uint32_t l = innermost[b]; l != noLoop && !contains(l, s);
+           l = all[l].parent) {
+        all[l].exits.push_back(s);
+      }
+    }
+  }
+  for (Loop& loop : all) {
+    std::sort(loop.exits.begin(), loop.exits.end());
+    loop.exits.erase(std::unique(loop.exits.begin(), loop.exits.end()),
+                     loop.exits.end());
+  }
+
+  findTripCounts(fn);
+}
+
+// The Loop instruction of a for loop sits in its exit block, whose only
+// predecessor is the end of the condition, inside the loop and in none
+// nested in it. The count is known when the start and step are constants
+// and the condition compares the binding the loop variable names with a
+// constant, provided nothing in the loop writes that binding but the
+// loop's own step: no assignment, and no other for loop over the same
+// variable.
+void LoopForest::findTripCounts(const IRFunction& fn) {
+  if (all.empty()) return;
+  auto valueInst = [&](std::uint32_t id) -> const IRInstruction* {
+    std::uint32_t index = id - static_cast<std::uint32_t>(fn.firstId);
+    return index < fn.valueInsts.size() ? &fn.insts[fn.valueInsts[index]]
+                                        : nullptr;
+  };
+  auto constant = [&](const IROperand& op) -> const IRInstruction* {
+    const IRInstruction* inst =
+        op.kind == IROperand::Value ? valueInst(op.index) : nullptr;
+    return inst && inst->op == IROpcode::Const ? inst : nullptr;
+  };
+
+  FunctionVariables vars(fn);
+  std::vector<std::uint32_t> varOfInst(fn.insts.size(),
+                                       FunctionVariables::noInst);
+  for (std::uint32_t v = 0; v < vars.size(); v++) {
+    varOfInst[vars.binding(v)] = v;
+  }
+  auto writtenIn = [&](std::uint32_t var, std::uint32_t loop,
+                       std::uint32_t self) {
+    for (std::uint32_t d = vars.firstDefinition(var);
+         d < vars.firstDefinition(var + 1); d++) {
+      const FunctionVariables::Definition& def = vars.definitions()[d];
+      bool other = def.kind == FunctionVariables::Definition::Write
+                       ? fn.insts[def.inst].op == IROpcode::Binary
+                       : def.inst != self;
+      if (other && contains(loop, def.block)) return true;
+    }
+    return false;
+  };
+
+  for (std::uint32_t i = 0; i < fn.insts.size(); i++) {
+    const IRInstruction& inst = fn.insts[i];
+    if (inst.op != IROpcode::Loop) continue;
+    const IRBlock& exit = fn.blocks[inst.block];
+    if (exit.preds.size() != 1 || innermost[exit.preds[0]] == noLoop) {
+      continue;
+    }
+    std::uint32_t loop = innermost[exit.preds[0]];
+    auto ops = fn.operandsOf(inst);
+    const IRInstruction* binding =
+        ops.size() > 6 ? valueInst(ops[6].index) : nullptr;
+    const IRInstruction* start = constant(ops[0]);
+    const IRInstruction* step = constant(ops[2]);
+    const IRInstruction* cond = valueInst(ops[1].index);
+    if (!binding || !start || !step || !cond ||
+        cond->op != IROpcode::Binary || cond->binop != '<') {
+      continue;
+    }
+    auto compared = fn.operandsOf(*cond);
+    auto isVariable = [&](const IROperand& op) {
+      return op.kind == IROperand::Value && op.index == ops[6].index;
+    };
+    bool below = isVariable(compared[0]);
+    const IRInstruction* bound = constant(compared[below ? 1 : 0]);
+    if (!bound || (!below && !isVariable(compared[1])) ||
+        writtenIn(varOfInst[binding - fn.insts.data()], loop, i)) {
+      continue;
+    }
+    all[loop].trips = constantTripCount(start->val, step->val, bound->val,
+                                        below);
+  }
+}
+
+void printLoops(AnalysisSession& session) {
+  IRWriter& out = session.out;
+  auto blocks = [&](std::span<const std::uint32_t> list) {
+    if (list.empty()) {
+      out << " -";
+      return;
+    }
+    for (std::uint32_t b : list) {
+      out << " B" << b;
+    }
+  };
+
+  out << "\nLOOPS:\n";
+  for (const IRFunction& fn : session.ir.functions) {
+    DominatorTree dom(fn, DominatorTree::Dominators);
+    LoopForest forest(fn, dom);
+    std::span<const LoopForest::Loop> loops = forest.loops();
+    out << '\n' << session.symbols.name(fn.name) << ": ";
+    if (loops.empty()) {
+      out << "no loops\n";
+      continue;
+    }
+    std::uint32_t deepest = 0;
+    for (const LoopForest::Loop& loop : loops) {
+      deepest = std::max(deepest, loop.depth);
+    }
+    out << loops.size() << (loops.size() == 1 ? " loop" : " loops")
+        << ", nested " << deepest << " deep\n";
+    for (const LoopForest::Loop& loop : loops) {
+      for (std::uint32_t d = 0; d < loop.depth; d++) {
+        out << "  ";
+      }
+      out << 'B' << loop.header << ": " << loop.numBlocks
+          << (loop.numBlocks == 1 ? " block" : " blocks") << ", latches";
+      blocks(loop.latches);
+      out << ", exits";
+      blocks(loop.exits);
+      out << ", trip count ";
+      switch (loop.trips.kind) {
+        case TripCount::Exact:
+          out << loop.trips.count;
+          break;
+        case TripCount::Endless:
+          out << "unbounded";
+          break;
+        case TripCount::Unknown:
+          out << "unknown";
+          break;
+      }
+      out << '\n';
+    }
+  }
+}
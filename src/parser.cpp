@@ -1,356 +1,413 @@
 #include "../include/parser.h"
 
+#include <algorithm>
+#include <atomic>
+#include <charconv>
 #include <cstdio>
-
-extern int getToken();
-
-char curTok;
-
-std::map<char, int> binOpPrecedence;
-
-std::map<std::string, PrototypeAST*> functionProtos;
-int justused = 0;
-std::vector<ExprAST*> justBefore;
-int id = 0;
-
-std::map<std::string, int> varIds;
-std::map<std::string, ExprAST*> definedFunctions;
-std::map<std::string, int> neededFunctions;
-std::multimap<ExprAST*, std::string> alreadyReturnedIfcont;
-
-int tempResolveTopLvlExpr = 0;
-
-ExprAST* parseNumberExpr();
-ExprAST* parseParenExpr();
-ExprAST* parsePrimary();
-ExprAST* parseBinOpRHS(int exprPrec, ExprAST* LHS);
-ExprAST* parseExpression();
-ExprAST* parseIdentifierExpr();
-PrototypeAST* parseProtoype();
-FunctionAST* parseDefinition();
-PrototypeAST* parseExtern();
-ExprAST* parseUnaryExpr();
-FunctionAST* parseTopLvlExpr();
-ExprAST* parseIfExpr();
-ExprAST* parseForExpr();
-ExprAST* parseVarExpr();
-
-int getNextToken() { return curTok = getToken(); }
-
-ExprAST* logError(const char* str) {
-  fprintf(stderr, "LogError: %s\n", str);
-  return nullptr;
+#include <thread>
+
+#include "../include/dataflow.h"
+#include "../include/dominators.h"
+#include "../include/explore.h"
+#include "../include/loops.h"
+#include "../include/pathnumbering.h"
+#include "../include/sampling.h"
+#include "../include/summary.h"
+
+int Parser::getNextToken() {
+  const TokenEntry& tok = tokens[std::min(tokPos, tokens.size() - 1)];
+  tokPos++;
+
+  if (tok.kind == tok_identifier) {
+    identifierSym = tok.payload;
+    identifierStr = symbols.name(identifierSym);
+  } else if (tok.kind == tok_number) {
+    numVal = constantPool[tok.payload];
+  }
+  curLoc.line = tok.line;
+  curLoc.col = tok.col;
+  return curTok = tok.kind;
 }
 
-PrototypeAST* logErrorP(const char* str) {
-  logError(str);
-  return nullptr;
+const TokenEntry& Parser::peekToken(std::size_t ahead) const {
+  return tokens[std::min(tokPos + ahead, tokens.size() - 1)];
 }
 
-ExprAST* parseNumberExpr() {
-  auto result = new NumberExprAST(numVal);
-  getNextToken();
-  return result;
+int Parser::seekToken(std::size_t pos) {
+  tokPos = pos;
+  return getNextToken();
 }
 
-ExprAST* parseParenExpr() {
-  getNextToken();
-  auto V = parseExpression();
-  if (!V) {
-    return nullptr;
-  }
-
-  if (curTok != ')') {
-    return logError("Expected ')'");
-  } else {
-    getNextToken();
-    return V;
-  }
+std::size_t Parser::curTokIndex() const {
+  return std::min(tokPos - 1, tokens.size() - 1);
 }
 
-ExprAST* parsePrimary() {
-  switch (curTok) {
-    case tok_identifier:
-      return parseIdentifierExpr();
-    case tok_number:
-      return parseNumberExpr();
-    case '(':
-      return parseParenExpr();
-    case tok_if:
-      return parseIfExpr();
-    case tok_for:
-      return parseForExpr();
-    case tok_var:
-      return parseVarExpr();
-    default:
-      return logError("Unknown token when expecting an expression");
+ExprAST* Parser::logError(const char* str) {
+  if (errorSink) {
+    errorSink->append("LogError: ").append(str).append("\n");
+  } else {
+    fprintf(stderr, "LogError: %s\n", str);
   }
+  return nullptr;
 }
 
-ExprAST* parseUnaryExpr() {
-  if (!isascii(curTok) || curTok == '(') {
-    return parsePrimary();
-  }
-
-  int opc = curTok;
-  getNextToken();
-
-  if (auto operand = parseUnaryExpr()) {
-    return new UnaryExprAST(opc, operand);
-  }
+PrototypeAST* Parser::logErrorP(const char* str) {
+  logError(str);
   return nullptr;
 }
 
-ExprAST* parseForExpr() {
-  getNextToken();
-
-  if (curTok != tok_identifier) {
-    logError("Expected a variable name after for");
-    return nullptr;
-  }
-
-  std::string idName = identifierStr;
-  getNextToken();
-
-  if (curTok != '=') {
-    logError("Expected an '=' after for");
-    return nullptr;
+int Parser::getTokPrecedence() {
+  if (!isascii(curTok)) {
+    return -1;
   }
-  getNextToken();
 
-  auto start = parseExpression();
-  if (!start) {
-    return nullptr;
+  // find() rather than operator[]: the table is shared by parser threads.
+  auto it = binOpPrecedence.find(curTok);
+  if (it == binOpPrecedence.end() || it->second <= 0) {
+    return -1;
   }
 
-  if (curTok != tok_when) {
-    logError("Expected when after for");
-    return nullptr;
-  }
-  getNextToken();
+  return it->second;
+}
 
-  auto cond = parseExpression();
-  if (!cond) {
-    return nullptr;
-  }
+// Expressions are parsed without recursion: every construct whose
+// sub-expressions are still pending (a binary operator chain, a prefix
+// operator, parentheses, call arguments, if/for/var) is a ParseFrame on an
+// explicit stack, so the nesting depth is only limited by memory. Tokens
+// are consumed, nodes created and errors reported in exactly the order of
+// the recursive-descent grammar this replaces:
+//
+//   expression := unary (binop unary)*     precedence climbing, left assoc.
+//   unary      := primary | ascii-op unary
+//   primary    := identifier | identifier '(' args ')' | number
+//               | '(' expression ')' | if | for | var
+ExprAST* Parser::parseExpression() {
+  openExpr();
+  ExprAST* value = nullptr;
+  while (true) {
+    // Parse the next operand: any prefix operators, then a primary.
+    while (isascii(curTok) && curTok != '(') {
+      ParseFrame frame{ParseFrame::Unary};
+      frame.op = curTok;
+      frames.push_back(frame);
+      getNextToken();
+    }
+    ParseStep step = startPrimary(value);
 
-  ExprAST* step;
-  if (curTok == tok_inc) {
-    getNextToken();
-    step = parseExpression();
-    if (!step) {
+    // Hand completed values to the innermost open construct until one of
+    // them needs another operand.
+    while (step == ParseStep::Value) {
+      if (frames.empty()) {
+        return value;
+      }
+      step = finishFrame(value);
+    }
+    if (step == ParseStep::Fail) {
+      abandonParse();
       return nullptr;
     }
   }
+}
 
-  if (curTok != tok_do) {
-    logError("Expected do after for");
-    return nullptr;
-  }
-  getNextToken();
-
-  if (curTok != '(') {
-    logError("Expected '(' after for ... ");
-  }
-
-  auto body = parseParenExpr();
-  if (!body) {
-    return nullptr;
-  }
-
-  return new ForExprAST(idName, start, cond, step, body);
+void Parser::openExpr() {
+  ParseFrame frame{ParseFrame::Expr};
+  frame.base = static_cast<std::uint32_t>(operands.size());
+  frame.opBase = static_cast<std::uint32_t>(binOps.size());
+  frames.push_back(frame);
 }
 
-ExprAST* parseVarExpr() {
+void Parser::openParen() {
   getNextToken();
+  frames.push_back(ParseFrame{ParseFrame::Paren});
+  openExpr();
+}
 
-  std::vector<std::pair<std::string, ExprAST*>> vars;
+Parser::ParseStep Parser::fail(const char* str) {
+  logError(str);
+  return ParseStep::Fail;
+}
 
-  if (curTok != tok_identifier) {
-    return logError("Expected identifier after var");
-  }
+void Parser::abandonParse() {
+  frames.clear();
+  operands.clear();
+  binOps.clear();
+  callArgs.clear();
+  varBindings.clear();
+}
 
-  while (true) {
-    std::string name = identifierStr;
-    getNextToken();
+void Parser::reduceBinOp() {
+  PendingBinOp op = binOps.back();
+  binOps.pop_back();
+  ExprAST* RHS = operands.back();
+  operands.pop_back();
+  ExprAST* LHS = operands.back();
+  operands.back() = newNode<BinaryExprAST>(op.loc, op.op, LHS, RHS);
+}
 
-    ExprAST* init;
-    if (curTok == '=') {
+Parser::ParseStep Parser::startPrimary(ExprAST*& value) {
+  switch (curTok) {
+    case tok_identifier: {
+      Symbol idName = identifierSym;
+      SourceLocation litLoc = curLoc;
+
+      getNextToken();
+      if (curTok != '(') {
+        value = newNode<VariableExprAST>(litLoc, idName);
+        return ParseStep::Value;
+      }
       getNextToken();
 
-      init = parseExpression();
-      if (!init) {
-        return nullptr;
+      if (curTok == ')') {
+        getNextToken();
+        value = newNode<CallExprAST>(litLoc, idName,
+                                     std::span<ExprAST* const>());
+        return ParseStep::Value;
       }
+      ParseFrame frame{ParseFrame::Call};
+      frame.loc = litLoc;
+      frame.name = idName;
+      frame.base = static_cast<std::uint32_t>(callArgs.size());
+      frames.push_back(frame);
+      openExpr();
+      return ParseStep::Operand;
     }
+    case tok_number:
+      value = newNode<NumberExprAST>(curLoc, numVal);
+      getNextToken();
+      return ParseStep::Value;
+    case '(':
+      openParen();
+      return ParseStep::Operand;
+    case tok_if: {
+      ParseFrame frame{ParseFrame::If};
+      frame.loc = curLoc;
+      getNextToken();
+      frames.push_back(frame);
+      openExpr();
+      return ParseStep::Operand;
+    }
+    case tok_for: {
+      getNextToken();
 
-    vars.push_back(std::make_pair(name, init));
+      if (curTok != tok_identifier) {
+        return fail("Expected a variable name after for");
+      }
 
-    if (curTok != ',') {
-      break;
-    }
+      ParseFrame frame{ParseFrame::For};
+      frame.name = identifierSym;
+      getNextToken();
 
-    getNextToken();
+      if (curTok != '=') {
+        return fail("Expected an '=' after for");
+      }
+      getNextToken();
 
-    if (curTok != tok_identifier) {
-      return logError("Expected identifier after var");
+      frames.push_back(frame);
+      openExpr();
+      return ParseStep::Operand;
     }
-  }
-
-  if (curTok != tok_in) {
-    return logError("Expected in after var");
-  }
-  getNextToken();
+    case tok_var: {
+      getNextToken();
 
-  auto body = parseExpression();
-  if (!body) {
-    return nullptr;
+      if (curTok != tok_identifier) {
+        return fail("Expected identifier after var");
+      }
+      ParseFrame frame{ParseFrame::Var};
+      frame.base = static_cast<std::uint32_t>(varBindings.size());
+      frames.push_back(frame);
+      return nextVarBinding();
+    }
+    default:
+      return fail("Unknown token when expecting an expression");
   }
-
-  return new VarExprAST(vars, body);
 }
 
-int getTokPrecedence() {
-  if (!isascii(curTok)) {
-    return -1;
-  }
-
-  int tokPrec = binOpPrecedence[curTok];
-
-  if (tokPrec <= 0) {
-    return -1;
-  }
+// Reads `name` or `name = init` of the innermost var frame; curTok is the
+// name.
+Parser::ParseStep Parser::nextVarBinding() {
+  Symbol name = identifierSym;
+  getNextToken();
 
-  return tokPrec;
+  if (curTok == '=') {
+    getNextToken();
+    frames.back().name = name;
+    frames.back().stage = 1;
+    openExpr();
+    return ParseStep::Operand;
+  }
+  // No initializer: the variable starts out as 0.0.
+  varBindings.emplace_back(name, newNode<NumberExprAST>(curLoc, 0.0));
+  return afterVarBinding();
 }
 
-ExprAST* parseBinOpRHS(int exprPrec, ExprAST* LHS) {
-  while (true) {
-    int tokPrec = getTokPrecedence();
-
-    if (tokPrec < exprPrec)  // to check if this is really a binary operator as
-                             // invalid tokens have precedence of -1
-    {
-      return std::move(LHS);
-    }
-
-    int binOp = curTok;
-    SourceLocation binLoc = curLoc;
+Parser::ParseStep Parser::afterVarBinding() {
+  if (curTok == ',') {
     getNextToken();
 
-    auto RHS = parseUnaryExpr();
-
-    if (!RHS) {
-      return nullptr;
-    }
-
-    int nextPrec = getTokPrecedence();
-
-    if (tokPrec < nextPrec) {
-      RHS = parseBinOpRHS(tokPrec + 1, std::move(RHS));
-
-      if (!RHS) {
-        return nullptr;
-      }
+    if (curTok != tok_identifier) {
+      return fail("Expected identifier after var");
     }
-
-    LHS = new BinaryExprAST(binLoc, binOp, LHS, RHS);
+    return nextVarBinding();
   }
-}
-
-ExprAST* parseExpression() {
-  auto LHS = parseUnaryExpr();
 
-  if (!LHS) {
-    return nullptr;
+  if (curTok != tok_in) {
+    return fail("Expected in after var");
   }
+  getNextToken();
 
-  return parseBinOpRHS(0, LHS);
+  frames.back().stage = 2;
+  openExpr();
+  return ParseStep::Operand;
 }
 
-ExprAST* parseIdentifierExpr() {
-  std::string idName = identifierStr;
-  SourceLocation litLoc = curLoc;
-
-  getNextToken();
-  if (curTok != '(') {
-    return new VariableExprAST(litLoc, idName);
-  }
-  getNextToken();
-
-  std::vector<ExprAST*> args;
+Parser::ParseStep Parser::finishFrame(ExprAST*& value) {
+  ParseFrame& frame = frames.back();
+  switch (frame.kind) {
+    case ParseFrame::Unary:
+      value = newNode<UnaryExprAST>(curLoc, frame.op, value);
+      frames.pop_back();
+      return ParseStep::Value;
+
+    case ParseFrame::Expr: {
+      operands.push_back(value);
+      int tokPrec = getTokPrecedence();
+      if (tokPrec >= 0) {
+        while (binOps.size() > frame.opBase && binOps.back().prec >= tokPrec) {
+          reduceBinOp();
+        }
+        binOps.push_back(
+            PendingBinOp{tokPrec, static_cast<char>(curTok), curLoc});
+        getNextToken();
+        return ParseStep::Operand;
+      }
+      while (binOps.size() > frame.opBase) {
+        reduceBinOp();
+      }
+      value = operands.back();
+      operands.resize(frame.base);
+      frames.pop_back();
+      return ParseStep::Value;
+    }
 
-  if (curTok != ')') {
-    while (true) {
-      if (auto arg = parseExpression()) {
-        args.push_back(arg);
-      } else {
-        return nullptr;
+    case ParseFrame::Paren:
+      if (curTok != ')') {
+        return fail("Expected ')'");
       }
+      getNextToken();
+      frames.pop_back();
+      return ParseStep::Value;
 
+    case ParseFrame::Call:
+      callArgs.push_back(value);
       if (curTok == ')') {
-        break;
+        getNextToken();
+        std::span<ExprAST* const> args(callArgs.data() + frame.base,
+                                       callArgs.size() - frame.base);
+        value = newNode<CallExprAST>(frame.loc, frame.name, args);
+        callArgs.resize(frame.base);
+        frames.pop_back();
+        return ParseStep::Value;
       }
-
       if (curTok != ',') {
-        return logError("Expected ',' after an argument in function call");
+        return fail("Expected ',' after an argument in function call");
       }
-
       getNextToken();
-    }
-  }
-
-  getNextToken();
-
-  return new CallExprAST(litLoc, idName, args);
-}
-
-ExprAST* parseIfExpr() {
-  SourceLocation ifLoc = curLoc;
-
-  getNextToken();
-
-  auto cond = parseExpression();
-  if (!cond) {
-    return nullptr;
-  }
-
-  if (curTok != tok_then) {
-    logError("Expected then");
-    return nullptr;
-  }
-  getNextToken();
-
-  if (curTok != '(') {
-    logError("Expected '(' after then");
-    return nullptr;
-  }
-
-  auto then = parseParenExpr();
-  if (!then) {
-    return nullptr;
-  }
+      openExpr();
+      return ParseStep::Operand;
+
+    case ParseFrame::If:
+      switch (frame.stage++) {
+        case 0:
+          frame.parts[0] = value;
+          if (curTok != tok_then) {
+            return fail("Expected then");
+          }
+          getNextToken();
+
+          if (curTok != '(') {
+            return fail("Expected '(' after then");
+          }
+          openParen();
+          return ParseStep::Operand;
+        case 1:
+          frame.parts[1] = value;
+          if (curTok != tok_else) {
+            return fail("Expected else");
+          }
+          getNextToken();
+
+          if (curTok != '(') {
+            return fail("Expected '(' after else");
+          }
+          openParen();
+          return ParseStep::Operand;
+        default:
+          value = newNode<IfExprAST>(frame.loc, frame.parts[0],
+                                     frame.parts[1], value);
+          frames.pop_back();
+          return ParseStep::Value;
+      }
 
-  if (curTok != tok_else) {
-    logError("Expected else");
-    return nullptr;
-  }
-  getNextToken();
+    case ParseFrame::For:
+      switch (frame.stage++) {
+        case 0:
+          frame.parts[0] = value;
+          if (curTok != tok_when) {
+            return fail("Expected when after for");
+          }
+          getNextToken();
+          openExpr();
+          return ParseStep::Operand;
+        case 1:
+          frame.parts[1] = value;
+          if (curTok == tok_inc) {
+            getNextToken();
+            openExpr();
+            return ParseStep::Operand;
+          }
+          // No `inc`: the loop variable steps by 1.0.
+          frame.parts[2] = newNode<NumberExprAST>(curLoc, 1.0);
+          frame.stage++;
+          break;
+        case 2:
+          frame.parts[2] = value;
+          break;
+        default:
+          value = newNode<ForExprAST>(curLoc, frame.name, frame.parts[0],
+                                      frame.parts[1], frame.parts[2], value);
+          frames.pop_back();
+          return ParseStep::Value;
+      }
+      // After the optional `inc` step.
+      if (curTok != tok_do) {
+        return fail("Expected do after for");
+      }
+      getNextToken();
 
-  if (curTok != '(') {
-    logError("Expected '(' after else");
-    return nullptr;
-  }
+      if (curTok != '(') {
+        logError("Expected '(' after for ... ");
+      }
+      openParen();
+      return ParseStep::Operand;
 
-  auto _else = parseParenExpr();
-  if (!_else) {
-    return nullptr;
+    case ParseFrame::Var:
+      if (frame.stage == 1) {
+        varBindings.emplace_back(frame.name, value);
+        return afterVarBinding();
+      }
+      {
+        std::span<const std::pair<Symbol, ExprAST*>> vars(
+            varBindings.data() + frame.base, varBindings.size() - frame.base);
+        value = newNode<VarExprAST>(curLoc, vars, value);
+      }
+      varBindings.resize(frame.base);
+      frames.pop_back();
+      return ParseStep::Value;
   }
-
-  return new IfExprAST(ifLoc, cond, then, _else);
+  return ParseStep::Fail;
 }
 
-PrototypeAST* parseProtoype() {
+PrototypeAST* Parser::parseProtoype() {
   std::string fnName;
 
   SourceLocation fnLoc = curLoc;
@@ -401,13 +458,13 @@ PrototypeAST* parseProtoype() {
   }
 
   std::vector<ExprAST*> argNames;
-  std::vector<std::string> argString;
+  std::vector<Symbol> argSymbols;
 
   int tok = getNextToken();
 
   while (tok == tok_identifier) {
-    argNames.push_back(new VariableExprAST(fnLoc, identifierStr));
-    argString.push_back(identifierStr);
+    argNames.push_back(newNode<VariableExprAST>(fnLoc, identifierSym));
+    argSymbols.push_back(identifierSym);
 
     tok = getNextToken();
     if (tok != ')') {
@@ -428,11 +485,11 @@ PrototypeAST* parseProtoype() {
     return logErrorP("Invalid number of operands for an operator");
   }
 
-  return new PrototypeAST(fnLoc, fnName, argNames, argString, kind != 0,
-                          binaryPrecedence);
+  return newNode<PrototypeAST>(fnLoc, symbols.intern(fnName), argNames,
+                               argSymbols, kind != 0, binaryPrecedence);
 }
 
-FunctionAST* parseDefinition() {
+FunctionAST* Parser::parseDefinition() {
   getNextToken();
 
   auto proto = parseProtoype();
@@ -441,76 +498,296 @@ FunctionAST* parseDefinition() {
   }
 
   if (auto exp = parseExpression()) {
-    return new FunctionAST(proto, exp);
+    return newNode<FunctionAST>(curLoc, proto, exp);
   }
 
   return nullptr;
 }
 
-PrototypeAST* parseExtern() {
+PrototypeAST* Parser::parseExtern() {
   getNextToken();
 
   return parseProtoype();
 }
 
-FunctionAST* parseTopLvlExpr() {
+FunctionAST* Parser::parseTopLvlExpr() {
   SourceLocation exprLoc = curLoc;
 
   if (auto exp = parseExpression()) {
-    auto proto = new PrototypeAST(exprLoc, "main", std::vector<ExprAST*>(),
-                                  std::vector<std::string>());
-    return new FunctionAST(proto, exp);
+    auto proto = newNode<PrototypeAST>(
+        exprLoc, symbols.intern("main"), std::vector<ExprAST*>(),
+        std::vector<Symbol>());
+    return newNode<FunctionAST>(curLoc, proto, exp);
   }
 
   return nullptr;
 }
 
-bool genDefinition() {
-  if (auto fn = parseDefinition()) {
-    definedFunctions.insert(
-        std::pair<std::string, FunctionAST*>(fn->proto->name, fn));
-    std::cout << "\nFUNCTION AST TRAVERSAL (Generated IR): " << std::endl;
-    fn->traverse();
-    varIds.clear();
+bool AnalysisSession::open(const std::string& fileName) {
+  if (!lexer.openSource(fileName)) {
+    return false;
+  }
+  lexer.lexAll();
+  parser.seekToken(0);
+  return true;
+}
+
+void AnalysisSession::traverseDefinition(FunctionAST* fn) {
+  definedFunctions.insert(fn->proto->name, fn);
+  traverse(fn);
+  varIds.clear();
+  if (emitIR) {
+    printIR(ir.functions.back(), symbols, out);
+  }
+}
+
+void AnalysisSession::reportErrors(const std::string& errors) {
+  if (errors.empty()) {
+    return;
+  }
+  out.flush();
+  fputs(errors.c_str(), stderr);
+}
+
+bool AnalysisSession::genDefinition() {
+  std::string errors;
+  parser.errorSink = &errors;
+  FunctionAST* fn = parser.parseDefinition();
+  parser.errorSink = nullptr;
+  reportErrors(errors);
+  if (fn) {
+    traverseDefinition(fn);
     return true;
   }
   return false;
 }
 
+// Parsing a definition only depends on the tokens from its `def` onwards,
+// so each one can be parsed speculatively from its own position; the
+// caller then replays the sequential main loop over the results. Every
+// name the parser may intern is interned up front, so the workers only
+// ever read the symbol table.
+std::vector<ParsedDefinition> AnalysisSession::parseDefinitionsParallel(
+    unsigned threads) {
+  const std::vector<TokenEntry>& tokens = lexer.tokens;
+  std::vector<ParsedDefinition> defs;
+  for (std::size_t i = 0; i < tokens.size(); i++) {
+    int kind = tokens[i].kind;
+    if (kind == tok_def) {
+      defs.push_back(ParsedDefinition{i, nullptr, 0, {}});
+    } else if ((kind == tok_binary || kind == tok_unary) &&
+               i + 1 < tokens.size() && isascii(tokens[i + 1].kind)) {
+      std::string name = kind == tok_binary ? "binary" : "unary";
+      name.push_back(static_cast<char>(tokens[i + 1].kind));
+      symbols.intern(name);
+    }
+  }
+  symbols.intern("main");
+
+  std::atomic<std::size_t> next{0};
+  auto work = [&](Arena* arena) {
+    Parser worker(lexer, symbols, binOpPrecedence, arena);
+    for (std::size_t i; (i = next.fetch_add(1)) < defs.size();) {
+      ParsedDefinition& def = defs[i];
+      worker.errorSink = &def.errors;
+      worker.seekToken(def.start);
+      def.fn = worker.parseDefinition();
+      def.resume = worker.curTokIndex();
+    }
+  };
+
+  threads = std::max(1u, std::min<unsigned>(threads, defs.size()));
+  std::vector<std::thread> workers;
+  for (unsigned t = 0; t < threads; t++) {
+    workerArenas.push_back(std::make_unique<Arena>());
+    workers.emplace_back(work, workerArenas.back().get());
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  return defs;
+}
+
 // CHECK CONTROL FLOW
 
-void printControlFlow() {
-  if (!definedFunctions.contains("main")) {
-    std::cout << "No main function (entry point) defined" << std::endl;
+void AnalysisSession::printControlFlow() {
+  Symbol mainSym = symbols.intern("main");
+  if (!definedFunctions.contains(mainSym)) {
+    out << "No main function (entry point) defined\n";
+    return;
+  }
+  flowGraph.build(definedFunctions);
+  out << "\nCONTROL FLOW:\n\n";
+  printControlFlowGraph(*this, flowGraph.entry(mainSym));
+}
+
+void AnalysisSession::printControlFlowSummary() {
+  Symbol mainSym = symbols.intern("main");
+  if (!definedFunctions.contains(mainSym)) {
+    out << "No main function (entry point) defined\n";
+    return;
+  }
+  out << "\nCONTROL FLOW SUMMARIES:\n\n";
+  printControlFlowSummaries(*this, mainSym);
+}
+
+void AnalysisSession::printPathCounts() {
+  out << "\nPATH COUNTS:\n\n";
+  // Only the definition calls resolve to, the first of a name.
+  SymbolMap<int> listed;
+  for (const IRFunction& fn : ir.functions) {
+    if (listed.contains(fn.name)) continue;
+    listed.insert(fn.name, 1);
+    PathNumbering paths(fn);
+    out << symbols.name(fn.name) << ": " << paths.count().toString()
+        << (paths.count() == BigUint(1) ? " path, " : " paths, ")
+        << fn.blocks.size()
+        << (fn.blocks.size() == 1 ? " block\n" : " blocks\n");
+  }
+}
+
+void AnalysisSession::printPath(std::string_view request) {
+  std::size_t colon = request.rfind(':');
+  BigUint id;
+  if (colon == std::string_view::npos ||
+      !BigUint::parse(request.substr(colon + 1), id)) {
+    out << "\nInvalid path request \"" << request
+        << "\" (expected function:id)\n";
     return;
   }
-  neededFunctions.insert(std::pair<std::string, int>("main", 1));
-  std::cout << std::endl << "CONTROL FLOW:" << std::endl << std::endl;
-  definedFunctions["main"]->showControl();
-  std::cout << "(program exit)" << std::endl;
-}
-
-void printFuncCat() {
-  std::cout << std::endl
-            << std::endl
-            << "Based on the control flow, we can assess the following:"
-            << std::endl;
-  std::cout << "The functions which are called (that is need to be compiled "
-               "and linked) are:"
-            << std::endl;
-  for (auto it = definedFunctions.begin(); it != definedFunctions.end(); it++) {
-    if (neededFunctions.contains(it->first)) {
-      std::cout << it->first << std::endl;
+  std::string_view name = request.substr(0, colon);
+  // The first definition, as for calls.
+  const IRFunction* fn = nullptr;
+  for (const IRFunction& f : ir.functions) {
+    if (symbols.name(f.name) == name) {
+      fn = &f;
+      break;
     }
   }
+  if (!fn) {
+    out << "\nFunction " << name << " not defined\n";
+    return;
+  }
+  PathNumbering paths(*fn);
+  std::vector<const PathNumbering::Edge*> edges;
+  if (!paths.decode(id, edges)) {
+    out << "\nPath " << id.toString() << " of " << name
+        << " out of range (" << paths.count().toString()
+        << (paths.count() == BigUint(1) ? " path)\n" : " paths)\n");
+    return;
+  }
+  std::string text;
+  PathNumbering::describe(edges, text);
+  out << "\nPath " << id.toString() << " of " << name << ": " << text << '\n';
+}
+
+void AnalysisSession::printAllPaths(unsigned threads) {
+  explorePaths(*this, threads);
+}
+
+void AnalysisSession::printPathSamples(std::string_view request,
+                                       unsigned threads) {
+  std::size_t colon = request.find(':');
+  std::string_view count = request.substr(0, colon);
+  std::string_view seedText =
+      colon == std::string_view::npos ? "1" : request.substr(colon + 1);
+  std::uint64_t walks = 0;
+  std::uint64_t seed = 0;
+  auto parse = [](std::string_view text, std::uint64_t& value) {
+    auto [end, ec] =
+        std::from_chars(text.data(), text.data() + text.size(), value);
+    return ec == std::errc() && end == text.data() + text.size();
+  };
+  if (!parse(count, walks) || walks == 0 || !parse(seedText, seed)) {
+    out << "\nInvalid sampling request \"" << request
+        << "\" (expected walks[:seed])\n";
+    return;
+  }
+  Symbol mainSym = symbols.intern("main");
+  if (!definedFunctions.contains(mainSym)) {
+    out << "No main function (entry point) defined\n";
+    return;
+  }
+  out << "\nPATH SAMPLES:\n\n";
+  ::printPathSamples(*this, mainSym, walks, seed, threads);
+}
 
-  std::cout << std::endl
-            << "The functions which are not called (that is do not need to be "
-               "compiled and linked) are:"
-            << std::endl;
-  for (auto it = definedFunctions.begin(); it != definedFunctions.end(); it++) {
-    if (!neededFunctions.contains(it->first)) {
-      std::cout << it->first << std::endl;
+void AnalysisSession::printDominators() {
+  printDominatorTrees(*this);
+}
+
+void AnalysisSession::printDataflow() {
+  ::printDataflow(*this);
+}
+
+void AnalysisSession::printLoops() {
+  ::printLoops(*this);
+}
+
+void AnalysisSession::printFuncCat() {
+  out << "\n\nBased on the control flow, we can assess the following:\n";
+  // Everything reachable from main in the call graph is needed.
+  callGraph.build(ir.functions);
+  DenseBitset needed(callGraph.size());
+  FunctionId mainFn = callGraph.find(symbols.intern("main"));
+  if (mainFn != noFunction) {
+    needed = callGraph.reachableFrom(mainFn);
+  }
+  auto isNeeded = [&](Symbol fn) {
+    FunctionId f = callGraph.find(fn);
+    return f != noFunction && needed.test(f);
+  };
+  // Report in name order, as the old std::map<std::string, ...> did.
+  std::vector<Symbol> defined = definedFunctions.keys();
+  std::sort(defined.begin(), defined.end(), [this](Symbol a, Symbol b) {
+    return symbols.name(a) < symbols.name(b);
+  });
+
+  out << "The functions which are called (that is need to be compiled "
+         "and linked) are:\n";
+  for (Symbol fn : defined) {
+    if (isNeeded(fn)) {
+      out << symbols.name(fn) << '\n';
+    }
+  }
+
+  out << "\nThe functions which are not called (that is do not need to be "
+         "compiled and linked) are:\n";
+  for (Symbol fn : defined) {
+    if (!isNeeded(fn)) {
+      out << symbols.name(fn) << '\n';
     }
   }
 }
+
+
+void AnalysisSession::printArenaUsage() {
+  std::size_t used = astArena.bytesUsed();
+  std::size_t reserved = astArena.bytesReserved();
+  std::size_t blocks = astArena.blockCount();
+  for (auto& arena : workerArenas) {
+    used += arena->bytesUsed();
+    reserved += arena->bytesReserved();
+    blocks += arena->blockCount();
+  }
+  out << "\nAST arena: " << used << " bytes used, " << reserved
+      << " bytes reserved in " << blocks << " blocks\n";
+  if (flowGraph.size() > 0) {
+    out << "Flow graph: " << flowGraph.size() << " nodes in "
+        << flowGraph.blockCount() << " blocks, " << flowGraph.bytes()
+        << " bytes\n";
+  }
+}
+
+// The nodes are released with the arenas in one go, so the tables pointing
+// at them are cleared first.
+void AnalysisSession::releaseCompilationUnit() {
+  definedFunctions.clear();
+  varIds.clear();
+  justBefore.clear();
+  flowGraph.clear();
+  callGraph.clear();
+  ir.functions.clear();
+  astArena.release();
+  workerArenas.clear();
+}
@@ -0,0 +1,88 @@
+#include "../include/pathnumbering.h"
+
+PathNumbering::PathNumbering(const IRFunction& fn) {
+  auto numBlocks = static_cast<std::uint32_t>(fn.blocks.size());
+  for (std::uint32_t b = 0; b < numBlocks; b++) {
+    if (fn.blocks[b].term == IRTerminator::Ret) exit = b;
+  }
+
+  // Blocks are numbered in traversal order, so an edge to a lower or equal
+  // index is a loop back edge, and block order is a topological order of
+  // what remains (the returning block is the last one). The dummy edges out
+  // of the entry come after its real ones.
+  std::vector<std::vector<Edge>> out(numBlocks);
+  for (std::uint32_t b = 0; b < numBlocks; b++) {
+    for (std::uint32_t succ : fn.blocks[b].succs) {
+      if (succ > b) {
+        out[b].push_back(Edge{b, succ, Edge::Real, 0, {}});
+      } else {
+        out[0].push_back(Edge{0, succ, Edge::FromEntry, 0, {}});
+        out[b].push_back(Edge{b, exit, Edge::ToExit, succ, {}});
+      }
+    }
+  }
+  std::vector<Edge> fromEntry;
+  for (Edge& e : out[0]) {
+    if (e.kind == Edge::FromEntry) fromEntry.push_back(e);
+  }
+  std::erase_if(out[0],
+                [](const Edge& e) { return e.kind == Edge::FromEntry; });
+  out[0].insert(out[0].end(), fromEntry.begin(), fromEntry.end());
+
+  numPaths.assign(numBlocks, BigUint());
+  for (std::uint32_t b = numBlocks; b-- > 0;) {
+    BigUint n = b == exit ? BigUint(1) : BigUint();
+    for (Edge& e : out[b]) {
+      e.increment = n;
+      n += numPaths[e.to];
+    }
+    numPaths[b] = n;
+  }
+
+  offsets.reserve(numBlocks + 1);
+  for (std::uint32_t b = 0; b < numBlocks; b++) {
+    offsets.push_back(static_cast<std::uint32_t>(edges.size()));
+    edges.insert(edges.end(), out[b].begin(), out[b].end());
+  }
+  offsets.push_back(static_cast<std::uint32_t>(edges.size()));
+}
+
+void PathNumbering::describe(std::span<const Edge* const> path,
+                              std::string& text) {
+  std::size_t i = 0;
+  if (!path.empty() && path[0]->kind == Edge::FromEntry) {
+    text += "(next iteration) B" + std::to_string(path[0]->to);
+    i = 1;
+  } else {
+    text += "B0";
+  }
+  for (; i < path.size(); i++) {
+    if (path[i]->kind == Edge::ToExit) {
+      text += " -> (back edge to B" + std::to_string(path[i]->header) + ")";
+      return;
+    }
+    text += " -> B" + std::to_string(path[i]->to);
+  }
+  text += " -> return";
+}
+
+bool PathNumbering::decode(BigUint id, std::vector<const Edge*>& path) const {
+  path.clear();
+  if (id >= count()) {
+    return false;
+  }
+  // At each block take the last edge whose increment does not exceed what
+  // is left of the id; the path ends at the exit once nothing is left.
+  std::uint32_t block = 0;
+  while (!(block == exit && id.isZero())) {
+    const Edge* taken = nullptr;
+    for (const Edge& e : edgesFrom(block)) {
+      if (e.increment > id) break;
+      taken = &e;
+    }
+    id -= taken->increment;
+    path.push_back(taken);
+    block = taken->to;
+  }
+  return true;
+}
@@ -0,0 +1,320 @@
+#include "../include/sampling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "../include/parser.h"
+#include "../include/summary.h"
+#include "../include/workpool.h"
+
+namespace {
+
+// A walk that is still going after this many blocks (an unbounded
+// recursion, say) is cut off and left out of the length estimates.
+constexpr std::uint32_t maxWalkBlocks = 1u << 16;
+constexpr std::uint64_t walksPerTask = 256;
+constexpr std::size_t reportedCallees = 10;
+constexpr std::uint32_t notDefined = ~std::uint32_t(0);
+constexpr double z = 1.96;  // 95% two-sided
+
+// splitmix64, one stream per walk.
+class WalkRandom {
+ public:
+  WalkRandom(std::uint64_t seed, std::uint64_t walk)
+      : state(seed ^ walk * 0xd1342543de82ef95ull) {}
+
+  std::uint64_t next() {
+    std::uint64_t x = state += 0x9e3779b97f4a7c15ull;
+    x = (x ^ x >> 30) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ x >> 27) * 0x94d049bb133111ebull;
+    return x ^ x >> 31;
+  }
+  std::uint32_t below(std::uint32_t n) {
+    return static_cast<std::uint32_t>(next() % n);
+  }
+
+ private:
+  std::uint64_t state;
+};
+
+struct SampledFunction {
+  const FunctionSummary* summary;
+  std::uint32_t firstBlock;  // index of B0 among all sampled blocks
+  // Calls of block b are callees[callOffsets[b] .. callOffsets[b + 1]), as
+  // indexes into Sampler::calleeNames.
+  std::vector<std::uint32_t> callOffsets;
+  std::vector<std::uint32_t> callees;
+};
+
+struct WalkRange {
+  std::uint64_t first = 0;
+  std::uint64_t last = 0;
+};
+
+// What one worker has seen. A block or callee counts once per walk; the
+// stamps hold the last walk (plus one) that counted it.
+struct Tally {
+  std::vector<std::uint64_t> blockWalks;
+  std::vector<std::uint64_t> blockStamps;
+  std::vector<std::uint64_t> calleeWalks;
+  std::vector<std::uint64_t> calleeStamps;
+
+  struct Frame {
+    std::uint32_t fn;
+    std::uint32_t block;
+    std::uint32_t call;  // next index into the function's callees
+  };
+  std::vector<Frame> frames;
+};
+
+class Sampler {
+ public:
+  Sampler(AnalysisSession& session, Symbol entry)
+      : table(session.ir.functions) {
+    // The functions reachable from the entry, each once, in the order they
+    // are first reached; the entry is function 0.
+    SymbolMap<std::uint32_t> functionIds;
+    SymbolMap<std::uint32_t> calleeIds;
+    std::vector<Symbol> work{entry};
+    functionIds.insert(entry, 0);
+    for (std::size_t next = 0; next < work.size(); next++) {
+      SampledFunction fn;
+      fn.summary = table.get(work[next]);
+      fn.firstBlock = totalBlocks;
+      totalBlocks += fn.summary->numBlocks;
+      const std::vector<CallSite>& calls = fn.summary->calls;
+      std::size_t call = 0;
+      for (std::uint32_t b = 0; b < fn.summary->numBlocks; b++) {
+        fn.callOffsets.push_back(
+            static_cast<std::uint32_t>(fn.callees.size()));
+        for (; call < calls.size() && calls[call].block == b; call++) {
+          Symbol callee = calls[call].callee;
+          if (!calleeIds.contains(callee)) {
+            calleeIds.insert(callee,
+                             static_cast<std::uint32_t>(calleeNames.size()));
+            calleeNames.push_back(callee);
+            std::uint32_t target = notDefined;
+            if (calls[call].defined && table.get(callee)) {
+              if (!functionIds.contains(callee)) {
+                functionIds.insert(callee,
+                                   static_cast<std::uint32_t>(work.size()));
+                work.push_back(callee);
+              }
+              target = functionIds.at(callee);
+            }
+            calleeFunctions.push_back(target);
+          }
+          fn.callees.push_back(calleeIds.at(callee));
+        }
+      }
+      fn.callOffsets.push_back(static_cast<std::uint32_t>(fn.callees.size()));
+      functions.push_back(std::move(fn));
+    }
+  }
+
+  void run(std::uint64_t walks, std::uint64_t seed, unsigned threads) {
+    this->seed = seed;
+    lengths.assign(walks, 0);
+    WorkStealingPool<WalkRange> pool(threads);
+    std::vector<Tally> tallies(pool.workers());
+    for (Tally& t : tallies) {
+      t.blockWalks.assign(totalBlocks, 0);
+      t.blockStamps.assign(totalBlocks, 0);
+      t.calleeWalks.assign(calleeNames.size(), 0);
+      t.calleeStamps.assign(calleeNames.size(), 0);
+    }
+    std::vector<WalkRange> ranges;
+    for (std::uint64_t first = 0; first < walks; first += walksPerTask) {
+      ranges.push_back(
+          WalkRange{first, std::min(walks, first + walksPerTask)});
+    }
+    pool.run(std::move(ranges), [&](unsigned worker, WalkRange& range) {
+      for (std::uint64_t i = range.first; i < range.last; i++) {
+        lengths[i] = walk(i, tallies[worker]);
+      }
+    });
+
+    // Counts are sums, so the order of the workers does not matter.
+    blockWalks.assign(totalBlocks, 0);
+    calleeWalks.assign(calleeNames.size(), 0);
+    for (const Tally& t : tallies) {
+      for (std::size_t b = 0; b < totalBlocks; b++) {
+        blockWalks[b] += t.blockWalks[b];
+      }
+      for (std::size_t c = 0; c < calleeNames.size(); c++) {
+        calleeWalks[c] += t.calleeWalks[c];
+      }
+    }
+  }
+
+  void print(AnalysisSession& session, std::uint64_t walks) const;
+
+ private:
+  // Number of blocks walk `i` went through, or maxWalkBlocks + 1 if it was
+  // cut off.
+  std::uint32_t walk(std::uint64_t i, Tally& t) const {
+    WalkRandom random(seed, i);
+    std::uint64_t stamp = i + 1;
+    std::uint32_t length = 0;
+    auto enter = [&](std::uint32_t fn, std::uint32_t block) {
+      std::uint32_t b = functions[fn].firstBlock + block;
+      if (t.blockStamps[b] != stamp) {
+        t.blockStamps[b] = stamp;
+        t.blockWalks[b]++;
+      }
+      return ++length <= maxWalkBlocks;
+    };
+
+    t.frames.clear();
+    t.frames.push_back(Tally::Frame{0, 0, functions[0].callOffsets[0]});
+    if (!enter(0, 0)) return length;
+    while (true) {
+      Tally::Frame& frame = t.frames.back();
+      const SampledFunction& fn = functions[frame.fn];
+      if (frame.call < fn.callOffsets[frame.block + 1]) {
+        std::uint32_t callee = fn.callees[frame.call++];
+        if (t.calleeStamps[callee] != stamp) {
+          t.calleeStamps[callee] = stamp;
+          t.calleeWalks[callee]++;
+        }
+        std::uint32_t target = calleeFunctions[callee];
+        if (target != notDefined) {
+          t.frames.push_back(
+              Tally::Frame{target, 0, functions[target].callOffsets[0]});
+          if (!enter(target, 0)) return length;
+        }
+        continue;
+      }
+      std::span<const std::uint32_t> succs = fn.summary->succs(frame.block);
+      if (succs.empty()) {
+        // The returning block: back to the call site.
+        t.frames.pop_back();
+        if (t.frames.empty()) return length;
+        continue;
+      }
+      auto choice = random.below(static_cast<std::uint32_t>(succs.size()));
+      frame.block = succs[choice];
+      frame.call = fn.callOffsets[frame.block];
+      if (!enter(frame.fn, frame.block)) return length;
+    }
+  }
+
+  SummaryTable table;
+  std::vector<SampledFunction> functions;
+  std::uint32_t totalBlocks = 0;
+  std::vector<Symbol> calleeNames;
+  std::vector<std::uint32_t> calleeFunctions;  // or notDefined
+
+  std::uint64_t seed = 0;
+  std::vector<std::uint32_t> lengths;  // per walk
+  std::vector<std::uint64_t> blockWalks;
+  std::vector<std::uint64_t> calleeWalks;
+};
+
+std::string fixed(double v, int decimals) {
+  char buf[64];
+  std::snprintf(buf, sizeof buf, "%.*f", decimals, v);
+  return buf;
+}
+
+// "p [lo, hi]" for `hits` out of `n`, with the Wilson score interval, which
+// stays inside [0, 1] and does not collapse when hits is 0 or n.
+std::string proportion(std::uint64_t hits, std::uint64_t n) {
+  double p = double(hits) / n;
+  double z2n = z * z / n;
+  double center = (p + z2n / 2) / (1 + z2n);
+  double half =
+      z / (1 + z2n) * std::sqrt(p * (1 - p) / n + z2n / (4 * n));
+  return fixed(p, 3) + " [" + fixed(std::max(0.0, center - half), 3) + ", " +
+         fixed(std::min(1.0, center + half), 3) + "]";
+}
+
+void Sampler::print(AnalysisSession& session, std::uint64_t walks) const {
+  IRWriter& out = session.out;
+  const SymbolTable& symbols = session.symbols;
+  out << walks << (walks == 1 ? " walk" : " walks") << " from "
+      << symbols.name(functions[0].summary->name) << ", seed " << seed
+      << ", 95% confidence intervals\n";
+
+  std::vector<std::uint32_t> done;
+  done.reserve(walks);
+  for (std::uint32_t length : lengths) {
+    if (length <= maxWalkBlocks) done.push_back(length);
+  }
+  if (done.size() < walks) {
+    out << walks - done.size() << " cut off after " << maxWalkBlocks
+        << " blocks\n";
+  }
+
+  out << "\nWalk length in blocks:";
+  if (done.empty()) {
+    out << " no walk returned\n";
+  } else {
+    double n = done.size();
+    double sum = 0;
+    double sumSquares = 0;
+    for (std::uint32_t length : done) {
+      sum += length;
+      sumSquares += double(length) * length;
+    }
+    double mean = sum / n;
+    double variance =
+        done.size() > 1 ? (sumSquares - sum * mean) / (n - 1) : 0;
+    double half = z * std::sqrt(std::max(0.0, variance) / n);
+    std::sort(done.begin(), done.end());
+    out << " mean " << fixed(mean, 2) << " [" << fixed(mean - half, 2) << ", "
+        << fixed(mean + half, 2) << "], median " << done[done.size() / 2]
+        << ", 90th percentile " << done[done.size() * 9 / 10] << ", max "
+        << done.back() << '\n';
+    // Power-of-two buckets: 1, 2-3, 4-7, ...
+    for (std::uint32_t low = 1; low <= done.back(); low *= 2) {
+      std::uint32_t high = low * 2 - 1;
+      auto first = std::lower_bound(done.begin(), done.end(), low);
+      auto last = std::upper_bound(first, done.end(), high);
+      if (first == last) continue;
+      out << "  " << low;
+      if (high > low) out << '-' << high;
+      out << ": " << proportion(last - first, done.size()) << '\n';
+    }
+  }
+
+  out << "\nCallees on most walks:\n";
+  std::vector<std::uint32_t> order(calleeNames.size());
+  for (std::uint32_t c = 0; c < order.size(); c++) order[c] = c;
+  std::sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) {
+    if (calleeWalks[a] != calleeWalks[b]) {
+      return calleeWalks[a] > calleeWalks[b];
+    }
+    return symbols.name(calleeNames[a]) < symbols.name(calleeNames[b]);
+  });
+  for (std::size_t i = 0; i < order.size() && i < reportedCallees; i++) {
+    std::uint32_t c = order[i];
+    if (calleeWalks[c] == 0) break;
+    out << "  " << symbols.name(calleeNames[c]);
+    if (calleeFunctions[c] == notDefined) out << " (not defined)";
+    out << ": " << proportion(calleeWalks[c], walks) << '\n';
+  }
+
+  out << "\nBlock coverage:\n";
+  for (const SampledFunction& fn : functions) {
+    out << "  " << symbols.name(fn.summary->name) << ":\n";
+    for (std::uint32_t b = 0; b < fn.summary->numBlocks; b++) {
+      out << "    B" << b << ": "
+          << proportion(blockWalks[fn.firstBlock + b], walks) << '\n';
+    }
+  }
+}
+
+}  // namespace
+
+void printPathSamples(AnalysisSession& session, Symbol entry,
+                      std::uint64_t walks, std::uint64_t seed,
+                      unsigned threads) {
+  Sampler sampler(session, entry);
+  sampler.run(walks, seed, threads);
+  sampler.print(session, walks);
+}
@@ -0,0 +1,117 @@
+#include "../include/summary.h"
+
+#include <limits>
+
+#include "../include/parser.h"
+
+namespace {
+
+FunctionSummary summarize(const IRFunction& fn) {
+  FunctionSummary s;
+  s.name = fn.name;
+  s.numBlocks = static_cast<std::uint32_t>(fn.blocks.size());
+  s.numInsts = static_cast<std::uint32_t>(fn.insts.size());
+
+  s.succOffsets.reserve(s.numBlocks + 1);
+  for (std::uint32_t b = 0; b < s.numBlocks; b++) {
+    const IRBlock& block = fn.blocks[b];
+    s.succOffsets.push_back(static_cast<std::uint32_t>(s.succList.size()));
+    s.succList.insert(s.succList.end(), block.succs.begin(),
+                      block.succs.end());
+    if (block.term == IRTerminator::Ret) {
+      s.exitBlock = b;
+    }
+  }
+  s.succOffsets.push_back(static_cast<std::uint32_t>(s.succList.size()));
+
+  for (const IRInstruction& inst : fn.insts) {
+    if (inst.op == IROpcode::Call) {
+      s.calls.push_back(CallSite{inst.block, inst.sym, !inst.external});
+    }
+  }
+
+  // Blocks are numbered in traversal order, so every edge to a lower or
+  // equal index is a loop back edge and the rest form a DAG that can be
+  // counted in reverse block order.
+  constexpr std::uint64_t saturated = std::numeric_limits<std::uint64_t>::max();
+  std::vector<std::uint64_t> paths(s.numBlocks, 0);
+  for (std::uint32_t b = s.numBlocks; b-- > 0;) {
+    std::uint64_t n = b == s.exitBlock ? 1 : 0;
+    for (std::uint32_t succ : s.succs(b)) {
+      if (succ <= b) continue;
+      n = paths[succ] > saturated - n ? saturated : n + paths[succ];
+    }
+    paths[b] = n;
+  }
+  s.paths = s.numBlocks ? paths[0] : 0;
+  return s;
+}
+
+}  // namespace
+
+SummaryTable::SummaryTable(const std::vector<IRFunction>& functions)
+    : functions(functions) {
+  for (std::uint32_t i = 0; i < functions.size(); i++) {
+    irIndex.insert(functions[i].name, i);
+  }
+}
+
+const FunctionSummary* SummaryTable::get(Symbol fn) {
+  if (cache.contains(fn)) {
+    return cache.at(fn);
+  }
+  if (!irIndex.contains(fn)) {
+    return nullptr;
+  }
+  const FunctionSummary* s =
+      &summaries.emplace_back(summarize(functions[irIndex.at(fn)]));
+  cache.insert(fn, s);
+  return s;
+}
+
+void printControlFlowSummaries(AnalysisSession& session, Symbol entry) {
+  IRWriter& out = session.out;
+  const SymbolTable& symbols = session.symbols;
+  SummaryTable table(session.ir.functions);
+
+  // Functions are queued when first reached, so each is printed once and
+  // the report is linear in the size of the reachable program.
+  SymbolMap<int> queued;
+  std::vector<Symbol> work{entry};
+  queued.insert(entry, 1);
+  for (std::size_t next = 0; next < work.size(); next++) {
+    const FunctionSummary& s = *table.get(work[next]);
+    out << "Function " << symbols.name(s.name) << ": " << s.numBlocks
+        << (s.numBlocks == 1 ? " block, " : " blocks, ") << s.numInsts
+        << " instructions, ";
+    if (s.paths == std::numeric_limits<std::uint64_t>::max()) {
+      out << "at least ";
+    }
+    out << s.paths << (s.paths == 1 ? " path" : " paths") << ", exit B"
+        << s.exitBlock << '\n';
+
+    std::size_t call = 0;
+    for (std::uint32_t b = 0; b < s.numBlocks; b++) {
+      out << "  B" << b << " ->";
+      if (b == s.exitBlock) {
+        out << " return";
+      }
+      for (std::uint32_t succ : s.succs(b)) {
+        out << " B" << succ;
+      }
+      out << '\n';
+      for (; call < s.calls.size() && s.calls[call].block == b; call++) {
+        Symbol callee = s.calls[call].callee;
+        out << "    call " << symbols.name(callee);
+        if (!s.calls[call].defined || !table.get(callee)) {
+          out << " (not defined)";
+        } else if (!queued.contains(callee)) {
+          queued.insert(callee, 1);
+          work.push_back(callee);
+        }
+        out << '\n';
+      }
+    }
+    out << '\n';
+  }
+}
@@ -0,0 +1,312 @@
+#include "../include/visitor.h"
+
+namespace {
+
+// The traversal that builds the IR and the control edges, one overload per
+// node type. Each call does the work that follows child `f.stage - 1` and
+// precedes child `f.stage`, and returns that child, or nullptr once the
+// node is finished; AnalysisSession::traverse() runs the steps on an
+// explicit stack, so nesting depth does not use the C++ stack.
+struct TraversalStep {
+  AnalysisSession& s;
+
+  // Makes `node` the successor of every node in s.justBefore.
+  void linkFromJustBefore(ExprAST& node) {
+    for (auto jB : s.justBefore) {
+      node.controlEdgesFrom.push_back(jB);
+      jB->controlEdgesTo.push_back(&node);
+    }
+  }
+
+  ExprAST* operator()(ExprAST&, TraversalFrame&) { return nullptr; }
+
+  ExprAST* operator()(NumberExprAST& n, TraversalFrame&) {
+    linkFromJustBefore(n);
+    s.id++;
+    s.ir.constant(s.id, n.val);
+    s.justused = s.id;
+    s.justBefore.clear();
+    s.justBefore.push_back(&n);
+    n.lastNode = &n;
+    n.startNode = &n;
+    return nullptr;
+  }
+
+  ExprAST* operator()(VariableExprAST& n, TraversalFrame&) {
+    int varId;
+    if (s.varIds.contains(n.name)) {
+      linkFromJustBefore(n);
+      varId = s.varIds[n.name];
+      s.justused = varId;
+      s.justBefore.clear();
+      s.justBefore.push_back(&n);
+      n.lastNode = &n;
+      n.startNode = &n;
+      return nullptr;
+    }
+    linkFromJustBefore(n);
+    s.id++;
+    varId = s.id;
+    s.justused = varId;
+    s.varIds.insert(n.name, varId);
+    s.ir.undeclared(varId, n.name);
+    s.justBefore.clear();
+    s.justBefore.push_back(&n);
+    n.lastNode = &n;
+    n.startNode = &n;
+    return nullptr;
+  }
+
+  ExprAST* operator()(VarExprAST& n, TraversalFrame& f) {
+    // Stage i <= vars.size() follows the initializer of vars[i - 1].
+    if (f.stage == 0) {
+      linkFromJustBefore(n);
+      s.justBefore.clear();
+      s.justBefore.push_back(&n);
+      n.startNode = &n;
+      s.ir.scopeBegin();
+      // Bindings shadowed by this scope go to s.savedVarIds from here on.
+      f.mark = static_cast<std::uint32_t>(s.savedVarIds.size());
+    } else if (f.stage <= n.vars.size()) {
+      Symbol name = n.vars[f.stage - 1].first;
+      s.id++;
+      int varId = s.id;
+      s.ir.bind(varId, name, s.justused);
+      s.varIds.insert(name, varId);
+    }
+    if (f.stage < n.vars.size()) {
+      auto& var = n.vars[f.stage];
+      if (s.varIds.contains(var.first)) {
+        s.savedVarIds.emplace_back(var.first, s.varIds[var.first]);
+        s.varIds.erase(var.first);
+      }
+      return var.second;
+    }
+    if (f.stage == n.vars.size()) {
+      return n.body;
+    }
+    for (auto& var : n.vars) {
+      s.varIds.erase(var.first);
+    }
+    for (std::size_t i = f.mark; i < s.savedVarIds.size(); i++) {
+      s.varIds.insert(s.savedVarIds[i].first, s.savedVarIds[i].second);
+    }
+    s.savedVarIds.resize(f.mark);
+    n.lastNode = n.body->lastNode;
+    s.ir.scopeEnd();
+    return nullptr;
+  }
+
+  ExprAST* operator()(BinaryExprAST& n, TraversalFrame& f) {
+    switch (f.stage) {
+      case 0:
+        return n.LHS;
+      case 1:
+        f.ids[0] = s.justused;
+        return n.RHS;
+    }
+    int lhs = f.ids[0];
+    int rhs = s.justused;
+    s.id++;
+    s.ir.binary(s.id, n.op, lhs, rhs);
+    s.justused = s.id;
+    linkFromJustBefore(n);
+    s.justBefore.clear();
+    s.justBefore.push_back(&n);
+    n.startNode = n.LHS->startNode;
+    n.lastNode = &n;
+    return nullptr;
+  }
+
+  ExprAST* operator()(UnaryExprAST& n, TraversalFrame& f) {
+    if (f.stage == 0) {
+      return n.operand;
+    }
+    linkFromJustBefore(n);
+    s.justBefore.clear();
+    s.justBefore.push_back(&n);
+    n.startNode = n.operand->startNode;
+    n.lastNode = &n;
+    s.id++;
+    s.ir.unary(s.id, n.op, s.justused);
+    s.justused = s.id;
+    return nullptr;
+  }
+
+  ExprAST* operator()(PrototypeAST& n, TraversalFrame&) {
+    linkFromJustBefore(n);
+    n.startNode = &n;
+    for (auto arg : n.argSymbols) {
+      s.id++;
+      int argId = s.id;
+      s.ir.param(argId, arg);
+      s.varIds.insert(arg, argId);
+    }
+    s.justBefore.clear();
+    s.justBefore.push_back(&n);
+    n.lastNode = &n;
+    return nullptr;
+  }
+
+  ExprAST* operator()(FunctionAST& n, TraversalFrame& f) {
+    switch (f.stage) {
+      case 0:
+        s.ir.beginFunction(n.proto->name);
+        n.owner = n.proto->name;
+        s.justBefore.clear();
+        s.justBefore.push_back(&n);
+        n.startNode = &n;
+        return n.proto;
+      case 1:
+        return n.body;
+    }
+    s.ir.endFunction(s.justused);
+    n.body->lastNode->isFuncEnd = true;
+    n.body->lastNode->funcDetails =
+        std::pair<Symbol, FunctionAST*>(n.proto->name, &n);
+    n.lastNode = n.body->lastNode;
+    s.justBefore.clear();
+    return nullptr;
+  }
+
+  ExprAST* operator()(CallExprAST& n, TraversalFrame& f) {
+    // The ids of the finished arguments go to s.argIds from f.mark on.
+    if (f.stage == 0) {
+      n.lastNode = &n;
+      f.mark = static_cast<std::uint32_t>(s.argIds.size());
+    } else {
+      s.argIds.push_back(s.justused);
+    }
+    if (f.stage < n.args.size()) {
+      return n.args[f.stage];
+    }
+    if (n.args.size() > 0)
+      n.startNode = n.args[0]->startNode;
+    else
+      n.startNode = &n;
+    linkFromJustBefore(n);
+    bool defined = s.definedFunctions.contains(n.callee);
+    if (defined) {
+      FunctionAST* func = s.definedFunctions[n.callee];
+      n.controlEdgesTo.push_back(func->body->startNode);
+      func->body->startNode->controlEdgesFrom.push_back(&n);
+      n.lastNode = func->body->lastNode;
+    }
+    s.id++;
+    int callId = s.id;
+    std::span<const int> argIds(s.argIds.data() + f.mark,
+                                s.argIds.size() - f.mark);
+    s.ir.call(callId, n.callee, argIds, defined);
+    s.argIds.resize(f.mark);
+    s.justused = callId;
+    s.justBefore.clear();
+    s.justBefore.push_back(n.lastNode);
+    return nullptr;
+  }
+
+  ExprAST* operator()(IfExprAST& n, TraversalFrame& f) {
+    switch (f.stage) {
+      case 0:
+        linkFromJustBefore(n);
+        s.justBefore.clear();
+        s.justBefore.push_back(&n);
+        n.startNode = &n;
+        n.ifcont->owner = n.owner;
+        return n.cond;
+      case 1:
+        f.ids[0] = s.justused;
+        s.ir.beginThen(f.ids[0]);
+        return n.then;
+      case 2:
+        f.ids[1] = s.justused;
+        s.ir.beginElse();
+        return n._else;
+    }
+    int thenId = f.ids[1];
+    int elseId = s.justused;
+    // The then branch fell through into the else branch; that edge is
+    // replaced by cond -> else and both branches -> ifcont.
+    ExprAST* thenLast = n.then->lastNode;
+    ExprAST* elseStart = n._else->startNode;
+    for (int i = thenLast->controlEdgesTo.size() - 1; i > -1; i--) {
+      if (thenLast->controlEdgesTo[i] == elseStart) {
+        thenLast->controlEdgesTo.erase(thenLast->controlEdgesTo.begin() + i);
+        for (int j = elseStart->controlEdgesFrom.size() - 1; j > -1; j--) {
+          if (elseStart->controlEdgesFrom[j] == thenLast) {
+            elseStart->controlEdgesFrom.erase(
+                elseStart->controlEdgesFrom.begin() + j);
+            break;
+          }
+        }
+        break;
+      }
+    }
+    n.cond->lastNode->controlEdgesTo.push_back(elseStart);
+    elseStart->controlEdgesFrom.push_back(n.cond->lastNode);
+    thenLast->controlEdgesTo.push_back(n.ifcont);
+    n.ifcont->controlEdgesFrom.push_back(thenLast);
+    n._else->lastNode->controlEdgesTo.push_back(n.ifcont);
+    n.ifcont->controlEdgesFrom.push_back(n._else->lastNode);
+    s.id++;
+    int ifId = s.id;
+    s.ir.endIf(ifId, thenId, elseId);
+    s.justused = ifId;
+    s.justBefore.clear();
+    n.lastNode = n.ifcont;
+    s.justBefore.push_back(n.ifcont);
+    return nullptr;
+  }
+
+  ExprAST* operator()(ForExprAST& n, TraversalFrame& f) {
+    switch (f.stage) {
+      case 0:
+        return n.start;
+      case 1:
+        f.ids[0] = s.justused;
+        s.ir.beginLoop();
+        return n.cond;
+      case 2:
+        f.ids[1] = s.justused;
+        s.ir.beginLoopBody(f.ids[1]);
+        return n.body;
+      case 3:
+        f.ids[2] = s.justused;
+        s.ir.beginLoopStep();
+        return n.step;
+    }
+    int startId = f.ids[0];
+    int condId = f.ids[1];
+    int bodyId = f.ids[2];
+    int stepId = s.justused;
+    n.step->controlEdgesTo.push_back(n.cond->startNode);
+    n.cond->controlEdgesFrom.push_back(n.step);
+    s.id++;
+    int forId = s.id;
+    // The name was bound before the loop or by its first use inside it.
+    int binding = s.varIds.contains(n.varName) ? s.varIds[n.varName] : 0;
+    s.ir.endLoop(forId, n.varName, startId, condId, stepId, bodyId, binding);
+    s.justused = forId;
+    s.justBefore.clear();
+    s.justBefore.push_back(n.cond->lastNode);
+    n.lastNode = n.cond->lastNode;
+    return nullptr;
+  }
+};
+
+}  // namespace
+
+void AnalysisSession::traverse(ExprAST* root) {
+  TraversalStep step{*this};
+  traversalStack.push_back(TraversalFrame{root});
+  while (!traversalStack.empty()) {
+    TraversalFrame& frame = traversalStack.back();
+    ExprAST* child = visitNode(*frame.node, step, frame);
+    if (!child) {
+      traversalStack.pop_back();
+      continue;
+    }
+    frame.stage++;
+    child->owner = frame.node->owner;
+    traversalStack.push_back(TraversalFrame{child});
+  }
+}
@@ -1,6 +1,13 @@
-#Graphing the time complexity of the traversal and analysis of the FAAST
+#Graphing the measured time complexity of the traversal and analysis of the FAAST
+#
+#Plots the complexity.json written by `./bench_fa complexity [size]` (see
+#bench/bench.cpp): one log-log panel per program shape, one line per phase,
+#labelled with the growth exponent fitted to it, and a dotted line of slope 1
+#for reference. Usage: python3 TimeComplexityGraph.py [complexity.json]
+
+import json
+import sys
 
-import numpy as np
 import matplotlib.pyplot as plt
 plt.rcParams.update({
     "text.usetex": True,
@@ -8,16 +15,28 @@ plt.rcParams.update({
     "font.serif": "Computer Modern",
 })
 
-t = np.arange(0, 10, 0.01)
-B = t
-W = t * np.log(t)
-A = 0.9 * W
-plt.plot(t, B, color='c', linewidth=1.5, label='Best-Case')
-plt.plot(t, A, color='k', linewidth=1.5, label='Average-Case')
-plt.plot(t, W, color='r', linewidth=1.5, label='Worst-Case')
-plt.tick_params(left = False, right = False, labelleft = False, labelbottom = False, bottom = False)
-plt.xlim(t[0], t[-1])
-plt.xlabel('$n$')
-plt.ylabel('$\mathcal{O}(n)$', rotation = 0, labelpad = 15)
-plt.legend()
-plt.show()
\ No newline at end of file
+path = sys.argv[1] if len(sys.argv) > 1 else 'complexity.json'
+with open(path) as f:
+    results = json.load(f)
+
+shapes = results['shapes']
+fig, axes = plt.subplots(1, len(shapes), figsize=(4 * len(shapes), 4),
+                         squeeze=False)
+for ax, shape in zip(axes[0], shapes):
+    n = shape['sizes']
+    for phase, measured in shape['phases'].items():
+        k = measured['exponent']
+        label = phase if k is None else '%s ($n^{%.2f}$)' % (phase, k)
+        ax.plot(n, measured['seconds'], marker='o', markersize=3,
+                linewidth=1.5, label=label)
+    first = max(m['seconds'][0] for m in shape['phases'].values())
+    ax.plot(n, [first * x / n[0] for x in n], color='k', linestyle=':',
+            linewidth=1, label='$n$')
+    ax.set_xscale('log')
+    ax.set_yscale('log')
+    ax.set_title(shape['shape'])
+    ax.set_xlabel('$n$')
+    ax.legend(fontsize='small')
+axes[0][0].set_ylabel('seconds')
+plt.tight_layout()
+plt.show()